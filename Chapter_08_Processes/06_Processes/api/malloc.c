@@ -0,0 +1,479 @@
+/*! Dynamic memory allocator: thread caches in front of GMA/first fit */
+
+#include <api/malloc.h>
+
+#include <api/pthread.h>
+#include <api/errno.h>
+#include <api/syscall.h>
+#include <arch/context.h>
+#include <lib/string.h>
+
+/*! Size classes (block sizes without header) */
+static const size_t class_size[] =
+	{ 16, 32, 48, 64, 96, 128, 192, 256, 384, 512 };
+#define CLASSES		(sizeof(class_size) / sizeof(size_t))
+#define LARGE		0xffff	/* "class" of blocks from back end */
+
+/* size class for request of 'size' bytes: class_of[(size + 15) / 16] */
+static const uint8 class_of[MALLOC_SMALL_MAX / 16 + 1] = {
+	0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+	8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9
+};
+
+#define CACHE_MAX	32	/* blocks of one class kept in thread cache */
+#define CACHE_BATCH	16	/* blocks moved from/to shared lists at once */
+
+/*! Block header, just before address returned to caller */
+typedef struct _mhdr_t_
+{
+	size_t  size;	/* usable size */
+	uint16  class;	/* size class or LARGE */
+	uint16  offset;	/* from back end block start to header */
+}
+mhdr_t;
+
+/*! Free small block: link is stored in block, behind header */
+typedef struct _mfree_t_
+{
+	struct _mfree_t_ *next;
+}
+mfree_t;
+
+#define HDR(ptr)	((mhdr_t *) (ptr) - 1)
+#define PTR(hdr)	((void *) ((mhdr_t *) (hdr) + 1))
+
+/*! Thread cache: per class free lists (pointer in thread local storage) */
+typedef struct _mcache_t_
+{
+	struct _mcache_t_ *next; /* in reclaim list (kernel links it; first!) */
+	mfree_t *list[CLASSES];
+	uint     count[CLASSES];
+}
+mcache_t;
+
+#define CACHE_OFFSET	__builtin_offsetof(pthread_tls_t, malloc_cache)
+
+/*! Back end pool, on initial heap or on its extension */
+typedef struct _mheap_t_
+{
+	void        *start;
+	void        *end;
+	MEM_ALLOC_T *mpool;
+}
+mheap_t;
+
+/* shared lists and back end are protected with 'lock' */
+static mfree_t *shared[CLASSES];
+static mheap_t heap[MALLOC_HEAPS];
+static int heaps;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *heap_alloc(size_t size);
+static void heap_free(void *block);
+static void *large_alloc(size_t size, size_t align);
+static mcache_t *get_cache();
+static mcache_t *reclaim();
+static void cache_release(mcache_t *cache);
+static int refill(mfree_t **list, int class, int count);
+
+/*! Set initial heap (process heap defined in config.ini) */
+void malloc_init(void *start, size_t size)
+{
+	heap[0].start = start;
+	heap[0].end = start + size;
+	heap[0].mpool = mem_init(start, size);
+	heaps = 1;
+
+	_uproc_->mpool = heap[0].mpool;
+}
+
+/*!
+ * Change heap size (heap is at the end of process memory)
+ * \param increment Number of bytes to add to heap (remove if negative)
+ * \return previous heap end, (void *) -1 if not enough memory
+ */
+void *sbrk(int increment)
+{
+	return (void *) syscall(SBRK, increment);
+}
+
+/*! Allocate 'size' bytes */
+void *malloc(size_t size)
+{
+	mcache_t *cache;
+	mfree_t *block;
+	int class;
+
+	if (size > MALLOC_SMALL_MAX)
+		return large_alloc(size, 0);
+
+	class = class_of[(size + 15) / 16];
+	cache = get_cache();
+
+	if (!cache)
+	{
+		/* no thread cache: take a block directly from shared list */
+		block = NULL;
+		pthread_mutex_lock(&lock);
+		refill(&block, class, 1);
+		pthread_mutex_unlock(&lock);
+
+		return block;
+	}
+
+	if (!cache->list[class])
+	{
+		pthread_mutex_lock(&lock);
+		cache->count[class] += refill(&cache->list[class], class,
+					      CACHE_BATCH);
+		pthread_mutex_unlock(&lock);
+
+		if (!cache->list[class])
+			return NULL;
+	}
+
+	block = cache->list[class];
+	cache->list[class] = block->next;
+	cache->count[class]--;
+
+	return block;
+}
+
+/*! Release block allocated with malloc, calloc, realloc or memalign */
+void free(void *ptr)
+{
+	mhdr_t *hdr;
+	mcache_t *cache;
+	mfree_t *block, *last;
+	int class, i;
+
+	if (!ptr)
+		return;
+
+	hdr = HDR(ptr);
+	class = hdr->class;
+	block = ptr;
+
+	if (class == LARGE)
+	{
+		pthread_mutex_lock(&lock);
+		heap_free((void *) hdr - hdr->offset);
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	cache = get_cache();
+	if (!cache)
+	{
+		pthread_mutex_lock(&lock);
+		block->next = shared[class];
+		shared[class] = block;
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	block->next = cache->list[class];
+	cache->list[class] = block;
+
+	if (++cache->count[class] > CACHE_MAX)
+	{
+		/* return a batch to shared list */
+		last = block;
+		for (i = 1; i < CACHE_BATCH; i++)
+			last = last->next;
+
+		cache->list[class] = last->next;
+		cache->count[class] -= CACHE_BATCH;
+
+		pthread_mutex_lock(&lock);
+		last->next = shared[class];
+		shared[class] = block;
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/*! Allocate zeroed array of 'nmemb' elements of 'size' bytes */
+void *calloc(size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if (size && nmemb > ((size_t) -1) / size)
+	{
+		set_errno(ENOMEM);
+		return NULL;
+	}
+
+	ptr = malloc(nmemb * size);
+	if (ptr)
+		memset(ptr, 0, nmemb * size);
+
+	return ptr;
+}
+
+/*! Change size of block (move it if it doesn't fit) */
+void *realloc(void *ptr, size_t size)
+{
+	void *new;
+	size_t old_size;
+
+	if (!ptr)
+		return malloc(size);
+
+	if (!size)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	old_size = HDR(ptr)->size;
+	if (size <= old_size)
+		return ptr;
+
+	new = malloc(size);
+	if (new)
+	{
+		memcpy(new, ptr, old_size);
+		free(ptr);
+	}
+
+	return new;
+}
+
+/*! Allocate 'size' bytes on address aligned to 'alignment' (power of 2) */
+void *memalign(size_t alignment, size_t size)
+{
+	if (!alignment || (alignment & (alignment - 1)) ||
+	    alignment > 0x8000)
+	{
+		set_errno(EINVAL);
+		return NULL;
+	}
+
+	if (alignment <= sizeof(size_t))
+		return malloc(size);
+
+	return large_alloc(size, alignment);
+}
+
+/*! Return blocks from thread cache to shared lists (on thread exit) */
+void malloc_thread_exit()
+{
+	mcache_t *cache;
+
+	cache = arch_tls_get(CACHE_OFFSET);
+	if (!cache)
+		return;
+
+	arch_tls_set(CACHE_OFFSET, NULL);
+
+	pthread_mutex_lock(&lock);
+	cache_release(cache);
+	pthread_mutex_unlock(&lock);
+}
+
+/*!
+ * Return blocks from cache to shared lists and free cache.
+ * Caller must hold 'lock'.
+ */
+static void cache_release(mcache_t *cache)
+{
+	mfree_t *last;
+	int class;
+
+	for (class = 0; class < CLASSES; class++)
+	{
+		if (!cache->list[class])
+			continue;
+
+		for (last = cache->list[class]; last->next; last = last->next)
+			;
+		last->next = shared[class];
+		shared[class] = cache->list[class];
+	}
+	heap_free(cache);
+}
+
+/*!
+ * Take caches of threads that ended without pthread_exit (kernel puts them on
+ * process reclaim list): first is returned for reuse, others are released.
+ * Caller must hold 'lock'.
+ */
+static mcache_t *reclaim()
+{
+	mcache_t *cache, *next;
+
+	/* atomic exchange: kernel might add to list at any time */
+	cache = __sync_lock_test_and_set(&_uproc_->malloc_reclaim, NULL);
+	if (!cache)
+		return NULL;
+
+	for (next = cache->next; next; next = cache->next)
+	{
+		cache->next = next->next;
+		cache_release(next);
+	}
+
+	return cache;
+}
+
+/*! Block from back end, with header; 'align' is zero or power of 2 */
+static void *large_alloc(size_t size, size_t align)
+{
+	void *block;
+	mhdr_t *hdr;
+
+	if (size > ((size_t) -1) - sizeof(mhdr_t) - align)
+	{
+		set_errno(ENOMEM);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&lock);
+	block = heap_alloc(size + sizeof(mhdr_t) + align);
+	pthread_mutex_unlock(&lock);
+
+	if (!block)
+	{
+		set_errno(ENOMEM);
+		return NULL;
+	}
+
+	hdr = block;
+	if (align)
+		hdr = HDR(((aint) PTR(block) + align - 1) & ~(align - 1));
+
+	hdr->size = size;
+	hdr->class = LARGE;
+	hdr->offset = (void *) hdr - block;
+
+	return PTR(hdr);
+}
+
+/*! Get thread cache, create it on first use */
+static mcache_t *get_cache()
+{
+	mcache_t *cache;
+
+	cache = arch_tls_get(CACHE_OFFSET);
+	if (cache)
+		return cache;
+
+	pthread_mutex_lock(&lock);
+	cache = reclaim();
+	if (!cache)
+	{
+		cache = heap_alloc(sizeof(mcache_t));
+		if (cache)
+			memset(cache, 0, sizeof(mcache_t));
+	}
+	pthread_mutex_unlock(&lock);
+
+	if (cache)
+		arch_tls_set(CACHE_OFFSET, cache);
+
+	return cache;
+}
+
+/*!
+ * Move up to 'count' blocks of size class 'class' from shared list to 'list';
+ * if shared list is empty carve new blocks from one back end block.
+ * Caller must hold 'lock'.
+ * \return number of blocks added to 'list'
+ */
+static int refill(mfree_t **list, int class, int count)
+{
+	mfree_t *first, *last;
+	mhdr_t *hdr;
+	size_t slot;
+	void *chunk;
+	int i;
+
+	if (!shared[class])
+	{
+		/* carve 'count' blocks; try with less if heap is short */
+		slot = sizeof(mhdr_t) + class_size[class];
+		do {
+			chunk = heap_alloc(slot * count);
+		}
+		while (!chunk && (count /= 2) > 0);
+
+		if (!chunk)
+		{
+			set_errno(ENOMEM);
+			return 0;
+		}
+
+		for (i = 0; i < count; i++)
+		{
+			hdr = chunk + i * slot;
+			hdr->size = class_size[class];
+			hdr->class = class;
+			hdr->offset = 0;
+			((mfree_t *) PTR(hdr))->next = i + 1 < count ?
+				PTR(chunk + (i + 1) * slot) : shared[class];
+		}
+		shared[class] = PTR(chunk);
+	}
+
+	first = last = shared[class];
+	for (i = 1; i < count && last->next; i++)
+		last = last->next;
+
+	shared[class] = last->next;
+	last->next = *list;
+	*list = first;
+
+	return i;
+}
+
+/*!
+ * Allocate block from back end pools; when none has enough space, extend
+ * heap with sbrk (at least by MALLOC_HEAP_GROW) and add new pool on it.
+ * Caller must hold 'lock'.
+ */
+static void *heap_alloc(size_t size)
+{
+	void *block, *start;
+	size_t grow;
+	int i;
+
+	/* newest pool first: older are probably full */
+	for (i = heaps - 1; i >= 0; i--)
+	{
+		block = mem_alloc(heap[i].mpool, size);
+		if (block)
+			return block;
+	}
+
+	/* (sbrk increment is int) */
+	if (heaps == MALLOC_HEAPS || size > 0x7fffffff - 2 * MALLOC_HEAP_GROW)
+		return NULL;
+
+	/* leave room for pool and chunk headers */
+	grow = (size + 2 * MALLOC_HEAP_GROW - 1) & ~(MALLOC_HEAP_GROW - 1);
+
+	start = sbrk(grow);
+	if (start == (void *) -1)
+		return NULL;
+
+	heap[heaps].start = start;
+	heap[heaps].end = start + grow;
+	heap[heaps].mpool = mem_init(start, grow);
+
+	return mem_alloc(heap[heaps++].mpool, size);
+}
+
+/*! Return block to its back end pool. Caller must hold 'lock'. */
+static void heap_free(void *block)
+{
+	int i;
+
+	for (i = 0; i < heaps; i++)
+	{
+		if (block >= heap[i].start && block < heap[i].end)
+		{
+			mem_free(heap[i].mpool, block);
+			return;
+		}
+	}
+}
@@ -5,9 +5,10 @@
 
 #include <api/pthread.h>
 #include <api/malloc.h>
+#include <api/syscall.h>
 
 /* symbols from user.ld */
-extern char user_code, user_end;
+extern char user_code, user_text, user_data, user_end;
 
 extern int PROG_START_FUNC(char *args[]);
 extern char PROG_HELP[];
@@ -34,6 +35,9 @@ __attribute__((section(".program_header"))) =
 		.heap_size =	HEAP_SIZE,
 		.stack_size =	STACK_SIZE,
 		.thread_stack =	THREAD_STACK_SIZE,
+
+		.text =		&user_text,
+		.text_end =	&user_data,
 	}
 };
 
@@ -47,11 +51,14 @@ void prog_init(void *args)
 {
 	_uproc_ = &_program_module_header_.proc;
 
+	/* use faster syscall entry, if kernel supports it */
+	syscall_fast = _uproc_->fast_syscall;
+
 	/* open stdin & stdout */
 	stdio_init();
 
 	/* initialize dynamic memory */
-	_uproc_->mpool = mem_init(_uproc_->heap, _uproc_->p.heap_size);
+	malloc_init(_uproc_->heap, _uproc_->p.heap_size);
 
 	/* call starting function */
 	((void (*)(void *)) _uproc_->p.entry)(args);
@@ -5,7 +5,12 @@
 #include <api/stdio.h>
 #include <api/syscall.h>
 #include <api/errno.h>
+#include <api/malloc.h>
 #include <types/basic.h>
+#include <arch/context.h>
+#include <arch/processor.h>
+
+static void pthread_key_destructors();
 
 /*! Thread creation/exit/wait/cancel ---------------------------------------- */
 
@@ -19,6 +24,9 @@ int pthread_create(pthread_t *thread, pthread_attr_t *attr,
 
 void pthread_exit(void *retval)
 {
+	pthread_key_destructors();
+	malloc_thread_exit();
+
 	syscall(PTHREAD_EXIT, retval);
 }
 
@@ -48,6 +56,7 @@ int pthread_attr_init(pthread_attr_t *attr)
 
 	attr->sched_policy = SCHED_FIFO;
 	attr->sched_params.sched_priority = THREAD_DEF_PRIO;
+	attr->sched_params.supp = (sched_supp_t) {{{0}}}; /* use defaults */
 
 	attr->stackaddr = NULL;
 	attr->stacksize = 0;
@@ -97,6 +106,45 @@ int pthread_setschedparam(pthread_t thread, int policy,
 	return syscall(PTHREAD_SETSCHEDPARAM, &thread, policy, param);
 }
 
+/*! EDF scheduling */
+int edf_set(timespec_t deadline, timespec_t period, int flags)
+{
+	pthread_t thread;
+	sched_param_t param;
+
+	thread = pthread_self();
+	param.sched_priority = 0; /* don't change priority */
+	param.supp.edf.deadline = deadline;
+	param.supp.edf.period = period;
+	param.supp.edf.flags = flags | EDF_SET;
+
+	return pthread_setschedparam(thread, SCHED_EDF, &param);
+}
+
+int edf_wait()
+{
+	pthread_t thread;
+	sched_param_t param;
+
+	thread = pthread_self();
+	param.sched_priority = 0; /* don't change priority */
+	param.supp.edf.flags = EDF_WAIT;
+
+	return pthread_setschedparam(thread, SCHED_EDF, &param);
+}
+
+int edf_exit()
+{
+	pthread_t thread;
+	sched_param_t param;
+
+	thread = pthread_self();
+	param.sched_priority = 0; /* don't change priority */
+	param.supp.edf.flags = EDF_EXIT;
+
+	return pthread_setschedparam(thread, SCHED_EDF, &param);
+}
+
 /*! Get thread scheduling parameters */
 int pthread_getschedparam(pthread_t thread, int *policy,
 			    struct sched_param *param)
@@ -106,6 +154,129 @@ int pthread_getschedparam(pthread_t thread, int *policy,
 	return EXIT_FAILURE;
 }
 
+/*!
+ * Set/get calling thread properties
+ * \param option PR_SET_TIMERSLACK or PR_GET_TIMERSLACK
+ * \param arg Timer slack in ns (for PR_SET_TIMERSLACK; 0 for default)
+ * \return timer slack for PR_GET_TIMERSLACK, 0 for PR_SET_TIMERSLACK; -1 on
+ *	   error
+ */
+int prctl(int option, long arg)
+{
+	ASSERT_ERRNO_AND_RETURN(option == PR_GET_TIMERSLACK ||
+		(option == PR_SET_TIMERSLACK && arg >= 0), EINVAL);
+
+	return syscall(PRCTL, option, arg);
+}
+
+/*! Thread specific data ---------------------------------------------------- */
+/* values are in thread local storage, keys are shared by process threads;
+ * value is valid only if set in current key generation (key delete starts new
+ * one, so values of deleted key left in other threads are not seen) */
+static struct
+{
+	int   used;
+	uint  gen;
+	void  (*destructor)(void *);
+}
+pthread_keys[PTHREAD_KEYS_MAX];
+
+#define SPECIFIC_OFFSET(key)	\
+	(__builtin_offsetof(pthread_tls_t, specific) + (key) * sizeof(void *))
+#define SPECIFIC_GEN_OFFSET(key)	\
+	(__builtin_offsetof(pthread_tls_t, specific_gen) + (key) * sizeof(uint))
+
+/*! Value of 'key' in this thread, if set in key's current generation */
+static void *pthread_specific_value(pthread_key_t key)
+{
+	if ((uint) arch_tls_get(SPECIFIC_GEN_OFFSET(key)) !=
+		pthread_keys[key].gen)
+		return NULL;
+
+	return arch_tls_get(SPECIFIC_OFFSET(key));
+}
+
+int pthread_key_create(pthread_key_t *key, void (*destructor)(void *))
+{
+	pthread_key_t k;
+
+	ASSERT_ERRNO_AND_RETURN(key, EINVAL);
+
+	for (k = 0; k < PTHREAD_KEYS_MAX; k++)
+	{
+		/* atomic test and set (xchg), threads might be preempted */
+		if (!__sync_lock_test_and_set(&pthread_keys[k].used, TRUE))
+		{
+			pthread_keys[k].destructor = destructor;
+			arch_tls_set(SPECIFIC_OFFSET(k), NULL);
+			*key = k;
+			return EXIT_SUCCESS;
+		}
+	}
+
+	set_errno(EAGAIN);
+	return EXIT_FAILURE;
+}
+
+int pthread_key_delete(pthread_key_t key)
+{
+	ASSERT_ERRNO_AND_RETURN(key >= 0 && key < PTHREAD_KEYS_MAX, EINVAL);
+	ASSERT_ERRNO_AND_RETURN(pthread_keys[key].used, EINVAL);
+
+	pthread_keys[key].destructor = NULL;
+	pthread_keys[key].gen++; /* values in all threads are now stale */
+	__sync_lock_release(&pthread_keys[key].used);
+
+	return EXIT_SUCCESS;
+}
+
+void *pthread_getspecific(pthread_key_t key)
+{
+	if (key < 0 || key >= PTHREAD_KEYS_MAX)
+		return NULL;
+
+	return pthread_specific_value(key);
+}
+
+int pthread_setspecific(pthread_key_t key, void *value)
+{
+	ASSERT_ERRNO_AND_RETURN(key >= 0 && key < PTHREAD_KEYS_MAX, EINVAL);
+	ASSERT_ERRNO_AND_RETURN(pthread_keys[key].used, EINVAL);
+
+	arch_tls_set(SPECIFIC_OFFSET(key), value);
+	arch_tls_set(SPECIFIC_GEN_OFFSET(key),
+		      (void *) pthread_keys[key].gen);
+
+	return EXIT_SUCCESS;
+}
+
+/*! Call destructors for thread's non-NULL values (at thread exit) */
+static void pthread_key_destructors()
+{
+	pthread_key_t k;
+	int i, called;
+	void *value;
+
+	for (i = 0; i < PTHREAD_DESTRUCTOR_ITERATIONS; i++)
+	{
+		called = FALSE;
+
+		for (k = 0; k < PTHREAD_KEYS_MAX; k++)
+		{
+			value = pthread_specific_value(k);
+			if (!value || !pthread_keys[k].destructor)
+				continue;
+
+			arch_tls_set(SPECIFIC_OFFSET(k), NULL);
+			pthread_keys[k].destructor(value);
+			called = TRUE;
+		}
+
+		if (!called)
+			break;
+	}
+}
+
 /*! Start program */
 int posix_spawn(pid_t *pid, char *path, void *file_actions,
 		  void *attrp, char *argv[], char *envp[])
@@ -115,31 +286,115 @@ int posix_spawn(pid_t *pid, char *path, void *file_actions,
 }
 
 
+/*! Futex: block until woken if *uaddr == val / wake up to count threads */
+static inline int futex_wait(int *uaddr, int val)
+{
+	return syscall(FUTEX_WAIT, uaddr, val);
+}
+static inline int futex_wake(int *uaddr, int count)
+{
+	return syscall(FUTEX_WAKE, uaddr, count);
+}
+static inline int futex_requeue(int *uaddr, int wake, int *uaddr2, int requeue)
+{
+	return syscall(FUTEX_REQUEUE, uaddr, wake, uaddr2, requeue);
+}
+
+/*! calling thread identification for mutex ownership (its TLS address) */
+#define SELF	arch_tls_get(__builtin_offsetof(pthread_tls_t, self))
+
 /*! Mutex */
 int pthread_mutex_init(pthread_mutex_t *mutex, pthread_mutexattr_t *attr)
 {
 	ASSERT_ERRNO_AND_RETURN(mutex, EINVAL);
-	return syscall(PTHREAD_MUTEX_INIT, mutex, attr);
+
+	mutex->id = 0;
+	mutex->ptr = NULL;
+	mutex->futex = 0;
+	mutex->owner = NULL;
+
+	/* only mutexes with priority protocol require kernel object */
+	if (attr && attr->protocol != PTHREAD_PRIO_NONE)
+		return syscall(PTHREAD_MUTEX_INIT, mutex, attr);
+
+	return EXIT_SUCCESS;
 }
 int pthread_mutex_destroy(pthread_mutex_t * mutex)
 {
 	ASSERT_ERRNO_AND_RETURN(mutex, EINVAL);
-	return syscall(PTHREAD_MUTEX_DESTROY, mutex);
+
+	if (mutex->ptr)
+		return syscall(PTHREAD_MUTEX_DESTROY, mutex);
+
+	ASSERT_ERRNO_AND_RETURN(!mutex->futex, EBUSY);
+
+	return EXIT_SUCCESS;
+}
+/*
+ * Lock futex based mutex; 'contended' is set when caller might have been
+ * moved to mutex queue by others (condition variable broadcast): it then
+ * must leave mutex marked as contended (2) so that unlock wakes next one
+ */
+static int mutex_lock(pthread_mutex_t *mutex, int contended)
+{
+	int c;
+
+	ASSERT_ERRNO_AND_RETURN(mutex->owner != SELF, EDEADLK);
+
+	/* fast path: 0 -> 1; otherwise mark contended (2) and wait */
+	if (contended)
+		c = atomic_xchg(&mutex->futex, 2);
+	else
+		c = atomic_cmpxchg(&mutex->futex, 0, 1);
+	if (c)
+	{
+		if (c != 2)
+			c = atomic_xchg(&mutex->futex, 2);
+		while (c)
+		{
+			futex_wait(&mutex->futex, 2);
+			c = atomic_xchg(&mutex->futex, 2);
+		}
+	}
+	mutex->owner = SELF;
+
+	return EXIT_SUCCESS;
 }
 int pthread_mutex_lock(pthread_mutex_t *mutex)
 {
 	ASSERT_ERRNO_AND_RETURN(mutex, EINVAL);
-	return syscall(PTHREAD_MUTEX_LOCK, mutex);
+
+	if (mutex->ptr)
+		return syscall(PTHREAD_MUTEX_LOCK, mutex);
+
+	return mutex_lock(mutex, FALSE);
 }
 int pthread_mutex_unlock(pthread_mutex_t *mutex)
 {
 	ASSERT_ERRNO_AND_RETURN(mutex, EINVAL);
-	return syscall(PTHREAD_MUTEX_UNLOCK, mutex);
+
+	if (mutex->ptr)
+		return syscall(PTHREAD_MUTEX_UNLOCK, mutex);
+
+	ASSERT_ERRNO_AND_RETURN(mutex->owner == SELF, EPERM);
+
+	mutex->owner = NULL;
+
+	/* fast path: 1 -> 0; if it was 2 someone might be waiting */
+	if (atomic_add(&mutex->futex, -1) != 1)
+	{
+		mutex->futex = 0;
+		futex_wake(&mutex->futex, 1);
+	}
+
+	return EXIT_SUCCESS;
 }
 int pthread_mutexattr_init(pthread_mutexattr_t *attr)
 {
 	ASSERT_ERRNO_AND_RETURN(attr, EINVAL);
-	*((uint*) attr) = 0;
+	attr->flags = 0;
+	attr->protocol = PTHREAD_PRIO_NONE;
+	attr->prioceiling = THREAD_MAX_PRIO;
 	return EXIT_SUCCESS;
 }
 int pthread_mutexattr_destroy(pthread_mutexattr_t *attr)
@@ -147,32 +402,121 @@ int pthread_mutexattr_destroy(pthread_mutexattr_t *attr)
 	ASSERT_ERRNO_AND_RETURN(attr, EINVAL);
 	return EXIT_SUCCESS;
 }
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol)
+{
+	ASSERT_ERRNO_AND_RETURN(attr, EINVAL);
+	ASSERT_ERRNO_AND_RETURN(protocol == PTHREAD_PRIO_NONE ||
+		protocol == PTHREAD_PRIO_INHERIT ||
+		protocol == PTHREAD_PRIO_PROTECT, ENOTSUP);
+	attr->protocol = protocol;
+	return EXIT_SUCCESS;
+}
+int pthread_mutexattr_getprotocol(pthread_mutexattr_t *attr, int *protocol)
+{
+	ASSERT_ERRNO_AND_RETURN(attr && protocol, EINVAL);
+	*protocol = attr->protocol;
+	return EXIT_SUCCESS;
+}
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+				       int prioceiling)
+{
+	ASSERT_ERRNO_AND_RETURN(attr, EINVAL);
+	ASSERT_ERRNO_AND_RETURN(prioceiling >= THREAD_MIN_PRIO &&
+		prioceiling <= THREAD_MAX_PRIO, EINVAL);
+	attr->prioceiling = prioceiling;
+	return EXIT_SUCCESS;
+}
+int pthread_mutexattr_getprioceiling(pthread_mutexattr_t *attr,
+				       int *prioceiling)
+{
+	ASSERT_ERRNO_AND_RETURN(attr && prioceiling, EINVAL);
+	*prioceiling = attr->prioceiling;
+	return EXIT_SUCCESS;
+}
 
 /*! Condition variable */
+int cond_requeue = TRUE;
+
 int pthread_cond_init(pthread_cond_t *cond, pthread_condattr_t *attr)
 {
 	ASSERT_ERRNO_AND_RETURN(cond, EINVAL);
-	return syscall(PTHREAD_COND_INIT, cond);
+
+	cond->seq = 0;
+	cond->waiters = 0;
+	cond->mutex = NULL;
+
+	return EXIT_SUCCESS;
 }
 int pthread_cond_destroy(pthread_cond_t *cond)
 {
 	ASSERT_ERRNO_AND_RETURN(cond, EINVAL);
-	return syscall(PTHREAD_COND_DESTROY, cond);
+	ASSERT_ERRNO_AND_RETURN(!cond->waiters, EBUSY);
+
+	return EXIT_SUCCESS;
 }
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
+	int seq, retval;
+
 	ASSERT_ERRNO_AND_RETURN(cond && mutex, EINVAL);
-	return syscall(PTHREAD_COND_WAIT, cond, mutex);
+
+	/* signal after mutex release changes seq, so futex_wait won't block */
+	seq = cond->seq;
+	atomic_add(&cond->waiters, 1);
+	cond->mutex = mutex;
+
+	retval = pthread_mutex_unlock(mutex);
+	if (retval)
+	{
+		atomic_add(&cond->waiters, -1);
+		return retval;
+	}
+
+	futex_wait(&cond->seq, seq);
+	atomic_add(&cond->waiters, -1);
+
+	if (mutex->ptr)
+		return syscall(PTHREAD_MUTEX_LOCK, mutex);
+
+	/* might be moved to mutex queue by broadcast */
+	return mutex_lock(mutex, TRUE);
 }
 int pthread_cond_signal(pthread_cond_t *cond)
 {
 	ASSERT_ERRNO_AND_RETURN(cond, EINVAL);
-	return syscall(PTHREAD_COND_SIGNAL, cond);
+
+	atomic_add(&cond->seq, 1);
+	if (cond->waiters)
+		futex_wake(&cond->seq, 1);
+
+	return EXIT_SUCCESS;
 }
 int pthread_cond_broadcast(pthread_cond_t *cond)
 {
+	pthread_mutex_t *mutex;
+
 	ASSERT_ERRNO_AND_RETURN(cond, EINVAL);
-	return syscall(PTHREAD_COND_BROADCAST, cond);
+
+	mutex = cond->mutex;
+
+	atomic_add(&cond->seq, 1);
+	if (!cond->waiters)
+		return EXIT_SUCCESS;
+
+	if (cond_requeue && mutex && !mutex->ptr)
+	{
+		/*
+		 * wake one, move others to mutex queue; mark mutex as
+		 * contended so that its unlock releases them one by one
+		 */
+		atomic_cmpxchg(&mutex->futex, 1, 2);
+		futex_requeue(&cond->seq, 1, &mutex->futex, cond->waiters);
+	}
+	else {
+		futex_wake(&cond->seq, cond->waiters);
+	}
+
+	return EXIT_SUCCESS;
 }
 
 int pthread_condattr_init(pthread_condattr_t *attr)
@@ -189,23 +533,53 @@ int pthread_condattr_destroy(pthread_condattr_t *attr)
 /*! Semaphore */
 int sem_init(sem_t *sem, int pshared, int value)
 {
-	ASSERT_ERRNO_AND_RETURN(sem, EINVAL);
-	return syscall(SEM_INIT, sem, pshared, value);
+	ASSERT_ERRNO_AND_RETURN(sem && value >= 0, EINVAL);
+
+	sem->value = value;
+	sem->waiters = 0;
+	sem->flags = pshared ? PTHREAD_PROCESS_SHARED : 0;
+
+	return EXIT_SUCCESS;
 }
 int sem_destroy(sem_t *sem)
 {
 	ASSERT_ERRNO_AND_RETURN(sem, EINVAL);
-	return syscall(SEM_DESTROY, sem);
+	ASSERT_ERRNO_AND_RETURN(!sem->waiters, EBUSY);
+
+	return EXIT_SUCCESS;
 }
 int sem_post(sem_t *sem)
 {
 	ASSERT_ERRNO_AND_RETURN(sem, EINVAL);
-	return syscall(SEM_POST, sem);
+
+	atomic_add(&sem->value, 1);
+	if (sem->waiters)
+		futex_wake(&sem->value, 1);
+
+	return EXIT_SUCCESS;
 }
 int sem_wait(sem_t *sem)
 {
+	int value;
+
 	ASSERT_ERRNO_AND_RETURN(sem, EINVAL);
-	return syscall(SEM_WAIT, sem);
+
+	for (;;)
+	{
+		value = sem->value;
+		if (value > 0)
+		{
+			if (atomic_cmpxchg(&sem->value, value, value - 1)
+			    == value)
+				return EXIT_SUCCESS;
+			continue;
+		}
+
+		/* value is 0: wait until it is changed */
+		atomic_add(&sem->waiters, 1);
+		futex_wait(&sem->value, 0);
+		atomic_add(&sem->waiters, -1);
+	}
 }
 
 /*! Message queue */
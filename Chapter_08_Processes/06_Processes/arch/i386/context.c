@@ -6,6 +6,8 @@
 #include "interrupt.h"
 #include "descriptor.h"
 #include <kernel/memory.h>
+#include <arch/memory.h>
+#include <kernel/errno.h>
 
 /*! kernel (interrupt) stack (defined in memory.c) */
 extern uint8 system_stack [];
@@ -16,10 +18,43 @@ void *arch_interrupt_stack;
 /*! where is thread context saved at interrupt? */
 uint32 arch_thr_context_ss;
 uint32 *arch_thr_context;
+#ifdef FAST_SYSCALL
+uint32 arch_thr_segm_start; /* process start address and last address */
+uint32 arch_thr_segm_max;   /* for word read, for sysenter (interrupt.S) */
+#endif
+
+/*! what is currently loaded in TSS and segment descriptors */
+static struct
+{
+	context_t *context;	/* selected thread context */
+	void	  *start;	/* its process segments start address */
+	size_t	   size;	/* and size */
+	void	  *tls;		/* its thread local storage */
+
+	uint	   switches;	/* number of context changes */
+	uint	   reloads;	/* and segment descriptors updates among them */
+}
+selected;
+
 #ifdef USE_SSE
 uint32 arch_sse_supported = 0; /* is SSE supported by processor? */
 uint32 arch_sse_mmx_fpu;	/* where to save extended thread context */
-#endif
+
+#ifdef SSE_LAZY
+/*
+ * Lazy saving of extended context: CR0.TS is set when switching to a thread
+ * whose context is not in FPU registers; its first FPU/MMX/SSE instruction
+ * causes #NM, when registers are saved for previous owner and loaded for
+ * active thread. Threads that never use FPU never cause save/restore.
+ */
+static context_t *sse_owner;	/* whose context is in FPU registers */
+static context_t *sse_active;	/* context of active thread */
+
+/* initial extended context, for thread first use of FPU */
+static uint8 sse_init_cntx[SSE_CNTX_SIZE]
+	__attribute__((aligned(SSE_CNTX_ALIGN)));
+#endif /* SSE_LAZY */
+#endif /* USE_SSE */
 
 /*! Set up context (normal and interrupt=kernel) */
 void arch_context_init()
@@ -29,6 +64,16 @@ void arch_context_init()
 	arch_interrupt_stack = (void *) &system_stack [ KERNEL_STACK_SIZE ];
 
 	arch_descriptors_init(); /* GDT, IDT, ... */
+
+#if defined(USE_SSE) && defined(SSE_LAZY)
+	sse_owner = sse_active = NULL;
+	if (arch_sse_supported)
+	{
+		/* save clean FPU/SSE state as template for new threads */
+		asm volatile ("fninit\n\t"
+			      "fxsave %0\n\t" : "=m" (sse_init_cntx));
+	}
+#endif
 }
 
 /*! context manipulation ---------------------------------------------------- */
@@ -41,6 +86,11 @@ void arch_create_thread_context(context_t *context,
 {
 	/* thread stack */
 	context->context.esp = stack + stack_size;
+#ifdef FAST_SYSCALL
+	/* syscall (ARCH/syscall.S) always reads 5 arguments from stack, even
+	 * if called with less; keep those reads within stack */
+	context->context.esp -= 4;
+#endif
 	/* put exit status on stack */
 	*(--context->context.esp) = (uint32) 0;
 	/* put starting thread function parameter on stack */
@@ -54,12 +104,17 @@ void arch_create_thread_context(context_t *context,
 	context->context.eip = (uint32) func;
 
 	context->context.ss = context->context.ds = context->context.es =
-	context->context.fs = context->context.gs = context->context.ss =
+	context->context.fs = context->context.ss =
 		GDT_DESCRIPTOR(SEGM_T_DATA, GDT, PRIV_USER);
+	context->context.gs = GDT_DESCRIPTOR(SEGM_T_TLS, GDT, PRIV_USER);
+	context->tls = NULL;
+	context->tls_size = 0;
+
+	/* not in syscall entered with sysenter */
+	context->context.err = 0;
 
 	/* rest of context is not relevant for new thread */
 #ifdef DEBUG
-	context->context.err = 0;
 	context->context.eax = context->context.ecx = context->context.edx =
 	context->context.ebx = context->context.ebp = context->context.esi =
 	context->context.edi = 0;
@@ -72,37 +127,158 @@ void arch_create_thread_context(context_t *context,
 #ifdef USE_SSE
 	if (arch_sse_supported)
 	{
+#ifndef SSE_LAZY
 	context->sse_mmx_fpu_start = kmalloc(SSE_CNTX_SIZE + SSE_CNTX_ALIGN);
 	/* align on 16 byte address */
 	context->sse_mmx_fpu =
 	(((uint32) context->sse_mmx_fpu_start) + SSE_CNTX_ALIGN-1) & 0xfffffff0;
+#else /* SSE_LAZY */
+	/* new state over existing one (signal handler): save old context
+	 * (its copy, saved in kernel/thread.c, shares the same area) */
+	if (sse_owner == context)
+	{
+		asm volatile ("clts\n\t"
+			      "fxsave (%0)\n\t" :: "r" (context->sse_mmx_fpu));
+		sse_owner = NULL;
+	}
+	/* storage is allocated on first use of FPU (arch_sse_switch) */
+	context->sse_mmx_fpu_start = NULL;
+	context->sse_mmx_fpu = 0;
+#endif /* SSE_LAZY */
 	}
 #endif
 
 }
 
+/*! Set thread local storage (gs segment) for thread context */
+void arch_set_thread_tls(context_t *context, void *tls, size_t size)
+{
+	context->tls = tls;
+	context->tls_size = size;
+}
+
 /*! Cleanups on context when deleting thread */
 void arch_destroy_thread_context(context_t *context)
 {
 #ifdef USE_SSE
 	if (arch_sse_supported)
-		kfree(context->sse_mmx_fpu_start);
+	{
+#ifdef SSE_LAZY
+		if (sse_owner == context)
+			sse_owner = NULL; /* drop registers content */
+		if (context->sse_mmx_fpu_start)
+			kfree(context->sse_mmx_fpu_start);
+		context->sse_mmx_fpu_start = NULL;
+#else
+		/* context may be destroyed twice (thread exit with saved
+		 * states: kthread_exit, then kthread_restore_state) */
+		if (context->sse_mmx_fpu_start)
+			kfree(context->sse_mmx_fpu_start);
+		context->sse_mmx_fpu_start = NULL;
+#endif
+	}
 #endif
 }
 
 /*! Select thread to return to from interrupt */
 void arch_select_thread(context_t *context)
 {
-	arch_thr_context = (void *) &context->context;
-	arch_tss_update(((void *) &context->context) + sizeof(arch_context_t));
+	void *start = k_process_start_adr(context->proc);
+	size_t size = k_process_size(context->proc);
+
+	if (context != selected.context)
+	{
+		arch_thr_context = (void *) &context->context;
+		arch_tss_update(((void *) &context->context) +
+				 sizeof(arch_context_t));
+		selected.context = context;
+		selected.switches++;
+	}
 
 #ifdef USE_SSE
+#ifndef SSE_LAZY
 	arch_sse_mmx_fpu = context->sse_mmx_fpu;
+#else /* SSE_LAZY */
+	sse_active = context;
+	if (arch_sse_supported)
+	{
+		if (sse_owner == context)
+			arch_sse_clts();
+		else
+			arch_sse_stts(); /* first FPU instruction will trap */
+	}
+#endif /* SSE_LAZY */
+#endif
+
+#ifdef PAGING
+	/* process page directory (idle thread keeps current one) */
+	arch_vm_select(k_process_vm(context->proc));
+#endif
+
+	/* update segment descriptors - only if process is changed */
+	if (start != selected.start || size != selected.size)
+	{
+		arch_upd_segm_descr(SEGM_T_CODE, start, size, PRIV_USER);
+		arch_upd_segm_descr(SEGM_T_DATA, start, size, PRIV_USER);
+		selected.start = start;
+		selected.size = size;
+		selected.reloads++;
+#ifdef FAST_SYSCALL
+		arch_thr_segm_start = (uint32) start;
+		arch_thr_segm_max = size - 4;
 #endif
+	}
+
+	if (context->tls && context->tls != selected.tls)
+	{
+		arch_upd_segm_descr(SEGM_T_TLS, context->tls,
+				      context->tls_size, PRIV_USER);
+		selected.tls = context->tls;
+	}
+}
+
+/*! Thread switches and segment reloads (for switches between processes) */
+void arch_context_stats(uint *switches, uint *segm_reloads)
+{
+	if (switches)
+		*switches = selected.switches;
+	if (segm_reloads)
+		*segm_reloads = selected.reloads;
+}
+
+#if defined(USE_SSE) && defined(SSE_LAZY)
+/*!
+ * Device not available (#NM) handler: active thread uses FPU/MMX/SSE while
+ * registers hold other thread context (or none) - swap contexts
+ */
+void arch_sse_switch(unsigned int inum)
+{
+	context_t *context = sse_active;
+
+	arch_sse_clts();
+
+	if (!context || sse_owner == context)
+		return;
+
+	if (sse_owner)
+		asm volatile ("fxsave (%0)\n\t" :: "r" (sse_owner->sse_mmx_fpu));
+
+	if (!context->sse_mmx_fpu_start)
+	{
+		/* first use of FPU in this context */
+		context->sse_mmx_fpu_start =
+			kmalloc(SSE_CNTX_SIZE + SSE_CNTX_ALIGN);
+		ASSERT(context->sse_mmx_fpu_start);
+		context->sse_mmx_fpu =
+			(((uint32) context->sse_mmx_fpu_start) +
+				SSE_CNTX_ALIGN - 1) & 0xfffffff0;
+
+		asm volatile ("fxrstor %0\n\t" :: "m" (sse_init_cntx));
+	}
+	else {
+		asm volatile ("fxrstor (%0)\n\t" :: "r" (context->sse_mmx_fpu));
+	}
 
-	/* update segment descriptors */
-	arch_upd_segm_descr(SEGM_T_CODE, k_process_start_adr(context->proc),
-			      k_process_size(context->proc), PRIV_USER);
-	arch_upd_segm_descr(SEGM_T_DATA, k_process_start_adr(context->proc),
-			      k_process_size(context->proc), PRIV_USER);
+	sse_owner = context;
 }
+#endif /* USE_SSE && SSE_LAZY */
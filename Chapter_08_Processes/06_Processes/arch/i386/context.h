@@ -33,6 +33,9 @@ struct _context_t_
 #endif
 
 	void           *proc; /* pointer to thread's process descriptor */
+
+	void           *tls;	/* thread local storage, segment for gs */
+	size_t          tls_size;
 };
 
 /*! context manipulation - for 'user threads' (in programs) ----------------- */
@@ -86,12 +89,48 @@ static inline void arch_switch_to_uthread(ucontext_t *from, ucontext_t *to)
 	);
 }
 
+/*! thread local storage: gs segment is set for it at thread switch */
+static inline void *arch_tls_get(uint offset)
+{
+	void *value;
+
+	asm volatile ("movl %%gs:(%1), %0\n\t" : "=r" (value) : "r" (offset));
+
+	return value;
+}
+
+static inline void arch_tls_set(uint offset, void *value)
+{
+	asm volatile ("movl %0, %%gs:(%1)\n\t"
+		:: "r" (value), "r" (offset) : "memory");
+}
+
+#if defined(USE_SSE) && defined(SSE_LAZY)
+/*! #NM handler - switch extended context (FPU/MMX/SSE) on first use */
+void arch_sse_switch(unsigned int inum);
+#endif
+
 #ifdef _ARCH_
 
 #ifdef USE_SSE
 /* for storing extended context: FPU, MMX, SSE */
 #define SSE_CNTX_SIZE	512
 #define SSE_CNTX_ALIGN	16	/* context start must be aligned */
-#endif
+
+#ifdef SSE_LAZY
+#define CR0_TS		(1 << 3)	/* task switched - FPU use traps */
+
+/*! clear/set CR0.TS - allow/trap (with #NM) next FPU/MMX/SSE instruction */
+#define arch_sse_clts()		asm volatile ("clts\n\t")
+static inline void arch_sse_stts()
+{
+	uint32 cr0;
+
+	asm volatile ("movl %%cr0, %0\n\t" : "=r" (cr0));
+	asm volatile ("movl %0, %%cr0\n\t" :: "r" (cr0 | CR0_TS));
+}
+#endif /* SSE_LAZY */
+
+#endif /* USE_SSE */
 
 #endif /* _ARCH_ */
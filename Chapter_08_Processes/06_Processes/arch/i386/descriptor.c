@@ -12,7 +12,8 @@ static GDT_t gdt[] =
 	GDT_0,
 	GDT_K_CODE, GDT_K_DATA,
 	GDT_T_CODE, GDT_K_DATA,
-	GDT_TSS
+	GDT_TSS,
+	GDT_T_DATA
 };
 
 /*! IDT */
@@ -21,12 +22,18 @@ static IDT_t idt[INTERRUPTS];
 /*! memory for TSS */
 static tss_t tss;
 
+#ifdef FAST_SYSCALL
+uint32 arch_sysenter_supported = 0; /* is sysenter set up? */
+#endif
 
 /*! Set up context (normal and interrupt=kernel) */
 void arch_descriptors_init()
 {
 	GDT_init();
 	IDT_init();
+#ifdef FAST_SYSCALL
+	SYSENTER_init();
+#endif
 }
 
 /*! Set up GDT */
@@ -40,6 +47,7 @@ static void GDT_init()
 	arch_upd_segm_descr(SEGM_T_CODE, NULL, (size_t) 0xffffffff, PRIV_USER);
 	arch_upd_segm_descr(SEGM_T_DATA, NULL, (size_t) 0xffffffff, PRIV_USER);
 	arch_upd_segm_descr(SEGM_TSS, &tss, sizeof(tss_t) - 1, PRIV_KERNEL);
+	arch_upd_segm_descr(SEGM_T_TLS, NULL, (size_t) 0xffffffff, PRIV_USER);
 
 	gdtr.gdt = gdt;
 	gdtr.limit = sizeof(gdt) - 1;
@@ -101,6 +109,37 @@ static void IDT_init()
 	asm ("lidt %0" : : "m" (idtr));
 }
 
+#ifdef FAST_SYSCALL
+/*! Set up fast syscall entry (sysenter), if processor supports it */
+static void SYSENTER_init()
+{
+	/*! defined in interrupts.S and context.c */
+	extern void arch_sysenter();
+	extern void *arch_interrupt_stack;
+	uint32 eax, ebx, ecx, edx;
+
+	asm volatile ("cpuid\n\t"
+		: "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+
+	if (!(edx & CPUID_SEP))
+		return;
+
+	/* Pentium Pro reports SEP without supporting it */
+	if (CPUID_FAMILY(eax) == 6 && CPUID_MODEL(eax) < 3 &&
+		CPUID_STEPPING(eax) < 3)
+		return;
+
+	/* sysenter loads SEGM_K_CODE and SEGM_K_DATA (next in GDT);
+	 * return is with iret (sysexit would load flat user segments) */
+	wrmsr(MSR_SYSENTER_CS, GDT_DESCRIPTOR(SEGM_K_CODE, GDT, PRIV_KERNEL));
+	/* stack is replaced with thread context in arch_sysenter */
+	wrmsr(MSR_SYSENTER_ESP, (uint32) arch_interrupt_stack);
+	wrmsr(MSR_SYSENTER_EIP, (uint32) arch_sysenter);
+
+	arch_sysenter_supported = 1;
+}
+#endif /* FAST_SYSCALL */
+
 /*! Update segment descriptor with starting address, size and privilege level */
 void arch_upd_segm_descr(int id, void *start_addr, size_t size,
 				  int priv_level)
@@ -108,7 +147,7 @@ void arch_upd_segm_descr(int id, void *start_addr, size_t size,
 	uint32 addr = (uint32) start_addr;
 	uint32 gsize = size;
 
-	ASSERT(id > 0 && id <= 5);
+	ASSERT(id > 0 && id <= SEGM_T_TLS);
 
 	gdt[id].base_addr0 =  addr & 0x0000ffff;
 	gdt[id].base_addr1 = (addr & 0x00ff0000) >> 16;
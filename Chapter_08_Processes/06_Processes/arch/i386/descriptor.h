@@ -8,6 +8,7 @@
 #define SEGM_T_CODE	3
 #define SEGM_T_DATA	4
 #define SEGM_TSS	5
+#define SEGM_T_TLS	6	/* thread local storage (through gs) */
 
 #define PRIV_KERNEL	0
 #define PRIV_USER	3
@@ -216,4 +217,24 @@ __attribute__((__packed__)) tss_t;
 static void GDT_init();
 static void IDT_init();
 
+#ifdef FAST_SYSCALL
+/** SYSENTER/SYSEXIT - fast syscall entry **/
+
+/*! CPUID (eax = 1) */
+#define CPUID_SEP		(1 << 11)	/* in edx: sysenter present */
+#define CPUID_FAMILY(eax)	(((eax) >> 8) & 0x0f)
+#define CPUID_MODEL(eax)	(((eax) >> 4) & 0x0f)
+#define CPUID_STEPPING(eax)	((eax) & 0x0f)
+
+/*! Model specific registers used by sysenter */
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
+
+#define wrmsr(msr, value)	\
+	asm volatile ("wrmsr\n\t" :: "c" (msr), "a" (value), "d" (0))
+
+static void SYSENTER_init();
+#endif /* FAST_SYSCALL */
+
 #endif /* _ARCH_DESCRIPTORS_C_ */
@@ -0,0 +1,192 @@
+/*! Local APIC timer (timer device), one-shot mode */
+#ifdef LAPIC
+
+#include "lapic.h"
+
+#include "../interrupt.h"
+#include "../processor.h"
+#ifdef PAGING
+#include "../paging.h"
+#endif
+
+#include <kernel/errno.h>
+
+/*! timer device local APIC, wrapper for arch_timer_t interface */
+arch_timer_t lapic = (arch_timer_t)
+{
+	.min_interval = {0, 0},
+	.max_interval = {0, 0},
+	.init = lapic_init,
+	.set_interval = lapic_set_time_to_counter,
+	.get_interval_remainder = lapic_get_time_from_counter,
+	.enable_interrupt = lapic_enable_interrupt,
+	.disable_interrupt = lapic_disable_interrupt,
+	.register_interrupt = lapic_register_interrupt
+};
+/* accessed from 'arch' layer via: extern arch_timer_t lapic */
+
+/* i8253 is used for calibration, or instead of APIC if there is none */
+extern arch_timer_t i8253;
+
+static aint lapic_base;		/* registers (physical address) */
+static uint32 lapic_freq;	/* timer counting frequency (after divider) */
+static uint32 lapic_count;	/* last count loaded */
+static uint32 lapic_lvt;	/* LVT timer entry: vector and mask */
+static void (*lapic_handler)();	/* 'arch' layer handler */
+
+/*!
+ * Enable local APIC (pass i8259 interrupts through LINT0), measure timer
+ * frequency and calculate min and max counting interval; without APIC i8253
+ * is used instead (its interface is copied here)
+ */
+static void lapic_init()
+{
+	uint32 eax, ebx, ecx, edx;
+	uint64 msr = 0;
+	uint32 cnt;
+
+	arch_cpuid(1, &eax, &ebx, &ecx, &edx);
+	if ((edx & (CPUID_APIC | CPUID_MSR)) == (CPUID_APIC | CPUID_MSR))
+		msr = arch_rdmsr(MSR_APIC_BASE);
+
+	if (!(msr & APIC_BASE_EN))
+	{
+		LOG(WARN, "Local APIC not present, using i8253 timer\n");
+		i8253.init();
+		lapic = i8253;
+		return;
+	}
+
+	lapic_base = (uint32) msr & APIC_BASE_MASK;
+#ifdef PAGING
+	arch_paging_map_io(lapic_base);
+#endif
+
+	LAPIC_REG(LAPIC_LVT_LINT0) = LVT_EXTINT;
+	LAPIC_REG(LAPIC_LVT_LINT1) = LVT_NMI;
+	LAPIC_REG(LAPIC_SVR) = SVR_ENABLE | LAPIC_SPURIOUS;
+
+	lapic_lvt = LVT_MASKED | IRQ_TIMER;
+	LAPIC_REG(LAPIC_LVT_TIMER) = lapic_lvt;
+	LAPIC_REG(LAPIC_DCR) = DCR_DIV16;
+
+	lapic_freq = lapic_calibrate();
+
+	lapic.min_interval.tv_sec = 0;
+	lapic.min_interval.tv_nsec = MIN_INTERVAL;
+	cnt = mul_div_32(MAX_INTERVAL, lapic_freq, N1E9);
+	COUNT_TO_TIME(cnt, &lapic.max_interval);
+
+	TIME_TO_COUNT(&lapic.max_interval, lapic_count);
+	LAPIC_REG(LAPIC_ICR) = lapic_count;
+}
+
+/*!
+ * Count APIC timer ticks while i8253 counts CALIBRATE ns
+ * \return APIC timer frequency (Hz)
+ */
+static int lapic_calibrate()
+{
+	timespec_t load, rem, start, now;
+	uint32 cnt_start, cnt_now;
+
+	i8253.init();
+	load = i8253.max_interval;
+
+	/* elapsed time is (counter is loaded with) load - remainder */
+	i8253.set_interval(&load);
+	LAPIC_REG(LAPIC_ICR) = 0xffffffff;
+	cnt_start = LAPIC_REG(LAPIC_CCR);
+	i8253.get_interval_remainder(&rem);
+	start = load;
+	time_sub(&start, &rem);
+	do {
+		cnt_now = LAPIC_REG(LAPIC_CCR);
+		i8253.get_interval_remainder(&rem);
+		now = load;
+		time_sub(&now, &rem);
+	}
+	while (now.tv_nsec < CALIBRATE);
+
+	LAPIC_REG(LAPIC_ICR) = 0; /* stop */
+
+	/* i8253 keeps counting, but its interrupt stays disabled in PIC */
+	time_sub(&now, &start);
+
+	return mul_div_32(cnt_start - cnt_now, N1E9, now.tv_nsec);
+}
+
+/*! Load counter with number equivalent to 'time' (starts counting) */
+static void lapic_set_time_to_counter(timespec_t *time)
+{
+	uint32 cnt;
+
+	ASSERT(time && time->tv_sec == 0 &&
+		 time->tv_nsec <= lapic.max_interval.tv_nsec &&
+		 time->tv_nsec >= lapic.min_interval.tv_nsec);
+
+	TIME_TO_COUNT(time, cnt);
+	if (!cnt)
+		cnt = 1;
+
+	lapic_count = cnt;
+	LAPIC_REG(LAPIC_ICR) = cnt;
+}
+
+/*! Read current value from counter and convert it into 'time' */
+static void lapic_get_time_from_counter(timespec_t *time)
+{
+	uint32 cnt;
+
+	ASSERT(time);
+
+	cnt = LAPIC_REG(LAPIC_CCR);
+
+	COUNT_TO_TIME(cnt, time);
+}
+
+/*! Enable counter interrupts */
+static void lapic_enable_interrupt()
+{
+	lapic_lvt &= ~LVT_MASKED;
+	LAPIC_REG(LAPIC_LVT_TIMER) = lapic_lvt;
+}
+
+/*! Disable counter interrupts */
+static void lapic_disable_interrupt()
+{
+	lapic_lvt |= LVT_MASKED;
+	LAPIC_REG(LAPIC_LVT_TIMER) = lapic_lvt;
+}
+
+/*! Register function for counter interrupts */
+static void lapic_register_interrupt(void *handler)
+{
+	lapic_handler = handler;
+	arch_register_interrupt_handler(IRQ_TIMER, lapic_interrupt, &lapic);
+	arch_register_interrupt_handler(LAPIC_SPURIOUS, lapic_spurious,
+					  &lapic);
+}
+
+/*!
+ * Timer interrupt: counter stopped at zero (one-shot); restart it with last
+ * count, as i8253 reloads itself ('arch' layer expects that: it may not load
+ * new interval), then forward interrupt
+ */
+static int lapic_interrupt(unsigned int irq, void *device)
+{
+	LAPIC_REG(LAPIC_ICR) = lapic_count;
+	LAPIC_REG(LAPIC_EOI) = 0;
+
+	lapic_handler();
+
+	return 0;
+}
+
+/*! Spurious interrupt: nothing to do (no EOI for it) */
+static int lapic_spurious(unsigned int irq, void *device)
+{
+	return 0;
+}
+
+#endif /* LAPIC */
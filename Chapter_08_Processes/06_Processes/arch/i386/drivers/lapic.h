@@ -0,0 +1,65 @@
+/*! Local APIC timer (timer device) - included from only lapic.c ! */
+#ifdef LAPIC
+
+#pragma once
+
+#ifndef I8253
+#error LAPIC timer is calibrated with I8253 (add both to DEVICES)
+#endif
+
+#include "../time.h"
+#include <kernel/time.h>
+#include <types/bits.h>
+
+#define N1E9		1000000000L
+
+/* local APIC registers (offsets from base, memory mapped, 32-bit access) */
+#define LAPIC_EOI	0x0b0
+#define LAPIC_SVR	0x0f0	/* spurious interrupt vector register */
+#define LAPIC_LVT_TIMER	0x320
+#define LAPIC_LVT_LINT0	0x350
+#define LAPIC_LVT_LINT1	0x360
+#define LAPIC_ICR	0x380	/* initial count (writing it starts counting) */
+#define LAPIC_CCR	0x390	/* current count */
+#define LAPIC_DCR	0x3e0	/* divide configuration */
+
+#define LAPIC_REG(R)	(*((volatile uint32 *) (lapic_base + (R))))
+
+#define MSR_APIC_BASE	0x1b
+#define APIC_BASE_EN	(1 << 11) /* APIC globally enabled */
+#define APIC_BASE_MASK	0xfffff000
+
+#define SVR_ENABLE	(1 << 8)  /* APIC software enable */
+#define LVT_MASKED	(1 << 16) /* (timer) one-shot mode: bits 17-18 = 0 */
+#define LVT_EXTINT	0x700	  /* LINT0: interrupts from i8259 pass through */
+#define LVT_NMI		0x400	  /* LINT1: NMI */
+#define DCR_DIV16	0x3
+
+/* spurious vector: same as slave PIC's spurious IRQ15 (bits 0-3 are 1111) */
+#define LAPIC_SPURIOUS	IRQ_RESERVED4
+
+#define CALIBRATE	50000000 /* ns; must be less than i8253 max_interval */
+#define MIN_INTERVAL	10000	 /* ns; shorter intervals are not useful */
+#define MAX_INTERVAL	999999999 /* ns; timespec_t with tv_sec == 0 */
+
+/* Calculate time from counter value ('lapic_freq' is measured in init) */
+#define COUNT_TO_TIME(C, T)	\
+do {(T)->tv_sec = 0;(T)->tv_nsec = mul_div_32(C, N1E9, lapic_freq); } while (0)
+
+/* Calculate counter value from time */
+#define TIME_TO_COUNT(T, C) \
+do { C = mul_div_32((T)->tv_nsec, lapic_freq, N1E9); } while (0)
+
+static void lapic_init();
+static int lapic_calibrate();
+static void lapic_enable_interrupt();
+static void lapic_disable_interrupt();
+
+static void lapic_register_interrupt(void *handler);
+static int lapic_interrupt(unsigned int irq, void *device);
+static int lapic_spurious(unsigned int irq, void *device);
+
+static void lapic_set_time_to_counter(timespec_t *time);
+static void lapic_get_time_from_counter(timespec_t *time);
+
+#endif /* LAPIC */
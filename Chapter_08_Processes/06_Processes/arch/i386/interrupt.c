@@ -3,6 +3,8 @@
 #define _ARCH_INTERRUPTS_C_
 #include "interrupt.h"
 
+#include "context.h"
+
 #include <arch/processor.h>
 #include <kernel/errno.h>
 #include <lib/list.h>
@@ -30,6 +32,9 @@ struct ihndlr
 	list_h list;
 };
 
+/*! interrupt handler descriptors */
+static kmem_cache_t ihndlr_cache;
+
 /*! Initialize interrupt susubsystem (in 'arch' layer) */
 void arch_init_interrupts()
 {
@@ -39,6 +44,13 @@ void arch_init_interrupts()
 
 	for (i = 0; i < INTERRUPTS; i++)
 		list_init(&ihandlers[i]);
+
+	kmem_cache_init(&ihndlr_cache, "ihndlr", sizeof(struct ihndlr), NULL);
+
+#if defined(USE_SSE) && defined(SSE_LAZY)
+	/* extended context (FPU/MMX/SSE) is switched on first use */
+	arch_register_interrupt_handler(INT_DEV_NA, arch_sse_switch, NULL);
+#endif
 }
 
 /*!
@@ -62,7 +74,7 @@ void arch_register_interrupt_handler(unsigned int inum, void *handler,
 
 	if (inum < INTERRUPTS)
 	{
-		ih = kmalloc(sizeof(struct ihndlr));
+		ih = kmem_cache_alloc(&ihndlr_cache);
 		ASSERT(ih);
 
 		ih->device = device;
@@ -91,7 +103,10 @@ void arch_unregister_interrupt_handler(unsigned int irq_num, void *handler,
 		next = list_get_next(&ih->list);
 
 		if (ih->ihandler == handler && ih->device == device)
+		{
 			list_remove(&ihandlers[irq_num], FIRST, &ih->list);
+			kmem_cache_free(&ihndlr_cache, ih);
+		}
 
 		ih = next;
 	}
@@ -3,12 +3,17 @@
 #pragma once
 
 /* Constants */
+#define INT_DEV_NA		7	/* Device Not Available (FPU) */
 #define INT_STF			12	/* Stack Fault */
 #define INT_GPF			13	/* General Protection Fault */
+#define INT_PAGE_FAULT		14
 
 #define INT_MEM_FAULT		INT_STF
 #define INT_UNDEF_FAULT		INT_GPF
 
+/* 'err' in thread context when thread entered kernel with sysenter */
+#define SYSENTER_FRAME		0x5ec0
+
 #ifndef ASM_FILE
 
 #include <arch/interrupt.h>
@@ -2,38 +2,64 @@
 
 #define _ARCH_
 #include <arch/memory.h>
+#include <arch/multiboot.h>
+#include <kernel/errno.h>
+
+#ifdef PAGING
+#include "paging.h"
+#elif defined(XIP)
+#error XIP requires PAGING
+#endif
 
 /*! kernel (interrupt) stack */
 uint8 system_stack [ KERNEL_STACK_SIZE ];
 
-/* adjust if more than 16 programs are used */
-#define MAX_MEMORY_SEGMENTS	16
+/* adjust if more than 53 programs are used */
+#define MAX_MEMORY_SEGMENTS	64
 
 /* reserve space for segment descriptors */
 static mseg_t mseg[MAX_MEMORY_SEGMENTS];
 
-/* multiboot information - currently not used */
+/* multiboot information (saved in boot/startup.S) */
 unsigned long arch_mb_magic, arch_mb_info;
 
+/*! Free memory regions (for heap), from multiboot memory map */
+#define MAX_REGIONS	8
+#define LOW_MEMORY	0x100000 /* memory below 1 MB (BIOS, loader) not used */
+#define MIN_REGION	0x10000	 /* smaller regions are not used */
+
+static struct {
+	uint start;
+	uint end;
+}
+region[MAX_REGIONS];
+static int regions;
+
+/* kernel and modules (not free) */
+static uint reserved_start, reserved_end;
+
+static int add_programs(int i, uint start, uint end);
+static void add_region(uint start, uint end);
+static void find_regions(multiboot_info_t *mbi);
 
 /*!
  * Create memory map:
- * - find place for heap
+ * - kernel and modules (programs), from multiboot module list
+ * - find place for heap: free memory regions from multiboot memory map
  */
 mseg_t *arch_memory_init()
 {
 	extern char kernel_code_addr, kernel_end_addr;
-	uint addr, end = (uint) &kernel_end_addr;
-	module_t *mod;
-	int i = 0;
+	multiboot_info_t *mbi = NULL;
+	multiboot_module_t *mod;
+	int i = 0, j;
+#ifdef PAGING
+	uint top;
+	int r;
+#endif
 
-	/* assuming memory map:
-	 * - kernel: kernel_code_addr -- kernel_end_addr
-	 * - (debug sections and loader stuff)
-	 * - module: [module_t header] [rest of module]
-	 * - (more modules)
-	 * - free memory => for heap
-	 */
+	if (arch_mb_magic == MULTIBOOT_BOOTLOADER_MAGIC)
+		mbi = (void *) arch_mb_info;
 
 	/* kernel segment - from kernel linker script */
 	mseg[i].type = MS_KERNEL;
@@ -41,31 +67,162 @@ mseg_t *arch_memory_init()
 	mseg[i].size = (uint) &kernel_end_addr - (uint) &kernel_code_addr;
 	i++;
 
-	for (addr = end; addr < SYSTEM_MEMORY; addr+=4)
+	reserved_start = (uint) &kernel_code_addr;
+	reserved_end = (uint) &kernel_end_addr;
+
+	if (mbi && (mbi->flags & MULTIBOOT_INFO_MODS))
+	{
+		/* programs are in modules (more programs in single module) */
+		mod = (void *) mbi->mods_addr;
+		for (j = 0; j < mbi->mods_count; j++)
+		{
+			i = add_programs(i, mod[j].mod_start, mod[j].mod_end);
+			if (mod[j].mod_end > reserved_end)
+				reserved_end = mod[j].mod_end;
+		}
+	}
+	else {
+		/* no module list: modules are expected right after kernel */
+		i = add_programs(i, reserved_end, SYSTEM_MEMORY);
+	}
+
+	find_regions(mbi);
+	ASSERT(regions > 0);
+
+#ifdef PAGING
+	/* page pool: page tables and process memory; from largest region */
+	top = reserved_end;
+	r = 0;
+	for (j = 0; j < regions; j++)
+	{
+		if (region[j].end > top)
+			top = region[j].end;
+		if (region[j].end - region[j].start >
+		    region[r].end - region[r].start)
+			r = j;
+	}
+
+	mseg[i].type = MS_PAGES;
+	mseg[i].start = (void *) ((region[r].start + PAGE_SIZE - 1) &
+				  PAGE_MASK);
+	mseg[i].size = ((region[r].end - (uint) mseg[i].start) /
+			PAGE_POOL_PART) & PAGE_MASK;
+	arch_paging_init(mseg[i].start, mseg[i].size, top);
+	region[r].start = (uint) mseg[i].start + mseg[i].size;
+	i++;
+#endif
+
+	/* kernel heap: all free regions */
+	for (j = 0; j < regions && i < MAX_MEMORY_SEGMENTS - 1; j++)
+	{
+		mseg[i].type = MS_KHEAP;
+		mseg[i].start = (void *) region[j].start;
+		mseg[i].size = region[j].end - region[j].start;
+		i++;
+	}
+
+	mseg[i].type = MS_END;
+
+	return mseg;
+}
+
+/*!
+ * Look for programs in memory from 'start' to 'end' (module loaded with
+ * kernel, which is concatenation of programs) and add them to memory map
+ * \return index for next memory segment
+ */
+static int add_programs(int i, uint start, uint end)
+{
+	uint addr;
+	module_t *mod;
+
+	for (addr = (start + 3) & ~3; addr + sizeof(module_t) <= end; addr+=4)
 	{
 		mod = (module_t *) addr;
 
 		if (mod->magic[0] == PMAGIC1 && mod->magic[1] == ~PMAGIC1 &&
 			mod->magic[2] == PMAGIC2 && mod->magic[3] == ~PMAGIC2)
 		{
+			if (i == MAX_MEMORY_SEGMENTS - 2 - MAX_REGIONS)
+			{
+				/* no space for more */
+				LOG(WARN, "Module %s not used (too many "
+				    "modules)!\n", mod->name);
+				addr += (size_t) mod->end - (size_t) mod->start
+					- 4;
+				continue;
+			}
+
 			/* found module at addr */
 			mseg[i].type = mod->type;
 			mseg[i].start = (void *) mod; /* physical address! */
 			mseg[i].size = (size_t) mod->end - (size_t) mod->start;
 			addr += mseg[i].size-4;
-			end = addr+4;
+			if (addr + 4 > reserved_end)
+				reserved_end = addr + 4;
 			i++;
-			continue;
 		}
 	}
 
-	/* kernel heap */
-	mseg[i].type = MS_KHEAP;
-	mseg[i].start = (void *) end;
-	mseg[i].size = SYSTEM_MEMORY - (uint) mseg[i].start;
-	i++;
+	return i;
+}
 
-	mseg[i].type = MS_END;
+/*! Free memory regions from multiboot information (or from SYSTEM_MEMORY) */
+static void find_regions(multiboot_info_t *mbi)
+{
+	multiboot_mmap_t *mm;
+	uint end;
 
-	return mseg;
+	regions = 0;
+
+	if (mbi && (mbi->flags & MULTIBOOT_INFO_MEM_MAP))
+	{
+		mm = (void *) mbi->mmap_addr;
+		while ((uint) mm < mbi->mmap_addr + mbi->mmap_length)
+		{
+			/* only 32 bit addresses are used */
+			if (mm->type == MULTIBOOT_MEMORY_AVAILABLE &&
+			    !mm->addr_high)
+			{
+				end = mm->addr_low + mm->len_low;
+				if (mm->len_high || end < mm->addr_low)
+					end = 0xfffff000;
+				add_region(mm->addr_low, end);
+			}
+			mm = (void *) mm + mm->size + sizeof(mm->size);
+		}
+	}
+	else if (mbi && (mbi->flags & MULTIBOOT_INFO_MEMORY))
+	{
+		add_region(LOW_MEMORY, LOW_MEMORY + mbi->mem_upper * 1024);
+	}
+	else {
+		add_region(LOW_MEMORY, SYSTEM_MEMORY);
+	}
+}
+
+/*! Add free memory region (without kernel and modules, if overlapping) */
+static void add_region(uint start, uint end)
+{
+	if (start < LOW_MEMORY)
+		start = LOW_MEMORY;
+#ifdef PAGING
+	/* addresses from VM_START are used for process address spaces */
+	if (end > VM_START)
+		end = VM_START;
+#endif
+
+	if (start < reserved_end && end > reserved_start)
+	{
+		add_region(start, reserved_start);
+		add_region(reserved_end, end);
+		return;
+	}
+
+	if (end <= start || end - start < MIN_REGION || regions == MAX_REGIONS)
+		return;
+
+	region[regions].start = start;
+	region[regions].end = end;
+	regions++;
 }
@@ -0,0 +1,402 @@
+/*! Paging: per process page directories, pages mapped on first touch */
+#ifdef PAGING
+
+#define _ARCH_
+#include "paging.h"
+
+#include <arch/memory.h>
+#include <kernel/memory.h>
+#include <kernel/errno.h>
+#include <lib/string.h>
+
+/*! Page pool: free pages are zeroed, linked through their first word */
+static void *free_pages;
+static uint pool_pages, pool_free;
+
+/*! Page directory with kernel (identity) mapping only */
+static uint32 *kernel_pd;
+static uint kernel_pdes; /* its used entries */
+
+/*! Page directory entries with device registers (above kernel_pdes) */
+#define IO_PDES		4
+static uint io_pde[IO_PDES];
+static uint io_pdes;
+
+/*! Process address spaces, by window */
+static arch_vm_t *vm_slot[VM_SLOTS];
+
+/*! Address space whose page directory is loaded (NULL for kernel_pd) */
+static arch_vm_t *vm_loaded;
+
+#define VM_END		(VM_START + VM_SLOTS * PT_SPAN)
+
+static inline void load_cr3(uint32 *pd)
+{
+	asm volatile ("movl %0, %%cr3\n\t" :: "r" (pd) : "memory");
+}
+
+static inline aint read_cr2()
+{
+	aint cr2;
+
+	asm volatile ("movl %%cr2, %0\n\t" : "=r" (cr2));
+	return cr2;
+}
+
+static void *page_alloc()
+{
+	void *page = free_pages;
+
+	if (page)
+	{
+		free_pages = *((void **) page);
+		*((void **) page) = NULL;
+		pool_free--;
+	}
+
+	return page;
+}
+
+static void page_free(void *page)
+{
+	memset(page, 0, PAGE_SIZE);
+	*((void **) page) = free_pages;
+	free_pages = page;
+	pool_free++;
+}
+
+/*!
+ * Build kernel page tables (identity mapping of memory up to 'memory_end') and
+ * enable paging; 'pool' is page aligned memory for page tables and process
+ * pages
+ */
+void arch_paging_init(void *pool, size_t size, aint memory_end)
+{
+	uint32 *pt, cr0;
+	uint i, j;
+
+	free_pages = NULL;
+	pool_free = 0;
+	for (i = size / PAGE_SIZE; i > 0; i--)
+		page_free(pool + (i - 1) * PAGE_SIZE);
+	pool_pages = pool_free;
+
+	kernel_pd = page_alloc();
+	kernel_pdes = (memory_end + PT_SPAN - 1) / PT_SPAN;
+	ASSERT(kernel_pdes <= (VM_START >> PT_SHIFT));
+
+	for (i = 0; i < kernel_pdes; i++)
+	{
+		pt = page_alloc();
+		for (j = 0; j < PT_ENTRIES; j++)
+			pt[j] = (i * PT_SPAN + j * PAGE_SIZE) | PTE_P | PTE_W;
+		kernel_pd[i] = (uint32) pt | PTE_P | PTE_W;
+	}
+
+	for (i = 0; i < VM_SLOTS; i++)
+		vm_slot[i] = NULL;
+	vm_loaded = NULL;
+	io_pdes = 0;
+
+	load_cr3(kernel_pd);
+	asm volatile ("movl %%cr0, %0\n\t" : "=r" (cr0));
+	cr0 |= 0x80000000; /* PG */
+	cr0 |= 0x00010000; /* WP: read only pages (XIP text) also for kernel */
+	asm volatile ("movl %0, %%cr0\n\t" :: "r" (cr0) : "memory");
+}
+
+/*!
+ * Identity map (uncached, kernel only) device registers at 'addr' (with whole
+ * PT_SPAN around it); mapping is added to all page directories
+ */
+void arch_paging_map_io(aint addr)
+{
+	uint32 *pt;
+	uint i, j, pde = addr >> PT_SHIFT;
+
+	if (pde < kernel_pdes || (kernel_pd[pde] & PTE_P))
+		return; /* already mapped */
+
+	ASSERT(io_pdes < IO_PDES && (addr < VM_START || addr >= VM_END));
+
+	pt = page_alloc();
+	ASSERT(pt);
+	for (j = 0; j < PT_ENTRIES; j++)
+		pt[j] = (pde * PT_SPAN + j * PAGE_SIZE) |
+			PTE_P | PTE_W | PTE_PWT | PTE_PCD;
+	kernel_pd[pde] = (uint32) pt | PTE_P | PTE_W;
+	io_pde[io_pdes++] = pde;
+
+	for (i = 0; i < VM_SLOTS; i++)
+		if (vm_slot[i])
+			vm_slot[i]->pd[pde] = kernel_pd[pde];
+}
+
+/*!
+ * Create address space for process of 'size' bytes; copy program 'image' to
+ * its start; rest (heap and stacks) is mapped on first touch.
+ * With XIP, pages from 'text' to 'text_end' (offsets in image, page aligned)
+ * are not copied: image pages are mapped instead (read only, shared).
+ * \return address space descriptor or NULL if not enough memory
+ */
+void *arch_vm_create(size_t size, void *image, size_t image_size,
+		       size_t text, size_t text_end)
+{
+	arch_vm_t *vm;
+	void *page;
+	uint slot, pages, i;
+	size_t copy;
+
+	for (slot = 0; slot < VM_SLOTS && vm_slot[slot]; slot++)
+		;
+
+	pages = (image_size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+#ifdef XIP
+	/* execute in place only from page aligned module */
+	if (((aint) image | text | text_end) & ~PAGE_MASK)
+#endif
+		text = text_end = 0;
+
+	if (slot == VM_SLOTS || size > PT_SPAN || pool_free < pages + 2)
+		return NULL;
+
+	vm = kmalloc(sizeof(arch_vm_t));
+	if (!vm)
+		return NULL;
+
+	vm->pd = page_alloc();
+	vm->pt = page_alloc();
+	vm->start = (void *) (VM_START + slot * PT_SPAN);
+	vm->size = size;
+
+	memcpy(vm->pd, kernel_pd, kernel_pdes * sizeof(uint32));
+	for (i = 0; i < io_pdes; i++)
+		vm->pd[io_pde[i]] = kernel_pd[io_pde[i]];
+	vm->pd[(aint) vm->start >> PT_SHIFT] =
+		(uint32) vm->pt | PTE_P | PTE_W | PTE_U;
+
+	vm->pages = 0;
+	for (i = 0; i < pages; i++)
+	{
+		if (i * PAGE_SIZE >= text && i * PAGE_SIZE < text_end)
+		{
+			vm->pt[i] = ((aint) image + i * PAGE_SIZE) |
+				     PTE_P | PTE_U | PTE_SHARED;
+			continue;
+		}
+		page = page_alloc();
+		copy = image_size - i * PAGE_SIZE;
+		if (copy > PAGE_SIZE)
+			copy = PAGE_SIZE;
+		memcpy(page, image + i * PAGE_SIZE, copy);
+		vm->pt[i] = (uint32) page | PTE_P | PTE_W | PTE_U;
+		vm->pages++;
+	}
+
+	vm_slot[slot] = vm;
+
+	return vm;
+}
+
+/*! Release address space and all its pages */
+void arch_vm_destroy(void *p)
+{
+	arch_vm_t *vm = p;
+	uint i;
+
+	if (vm == vm_loaded)
+	{
+		load_cr3(kernel_pd);
+		vm_loaded = NULL;
+	}
+
+	for (i = 0; i < PT_ENTRIES; i++)
+		if ((vm->pt[i] & (PTE_P | PTE_SHARED)) == PTE_P)
+			page_free((void *) (vm->pt[i] & PAGE_MASK));
+
+	page_free(vm->pt);
+	page_free(vm->pd);
+
+	vm_slot[((aint) vm->start - VM_START) >> PT_SHIFT] = NULL;
+	kfree(vm);
+}
+
+/*!
+ * Change address space size: pages above new size are released, growth only
+ * moves the limit (new pages are mapped on first touch)
+ * \return 0 if successful, -1 if size is over window size
+ */
+int arch_vm_resize(void *p, size_t size)
+{
+	arch_vm_t *vm = p;
+	uint i;
+
+	if (size > PT_SPAN)
+		return -1;
+
+	for (i = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+	     i * PAGE_SIZE < vm->size; i++)
+	{
+		if ((vm->pt[i] & (PTE_P | PTE_SHARED)) == PTE_P)
+		{
+			page_free((void *) (vm->pt[i] & PAGE_MASK));
+			vm->pages--;
+		}
+		vm->pt[i] = 0;
+	}
+	vm->size = size;
+
+	if (vm == vm_loaded)
+		load_cr3(vm->pd); /* flush TLB for removed pages */
+
+	return 0;
+}
+
+/*! Process start address (linear), for its segment descriptors */
+void *arch_vm_start(void *vm)
+{
+	return ((arch_vm_t *) vm)->start;
+}
+
+/*! Number of pages owned by address space (shared text not included) */
+uint arch_vm_pages(void *vm)
+{
+	return ((arch_vm_t *) vm)->pages;
+}
+
+/*!
+ * Stack usage on demand paged memory: bytes from lowest mapped page in
+ * [addr, addr + size) to its end (linear addresses inside process window)
+ */
+size_t arch_vm_mapped_top(void *p, void *addr, size_t size)
+{
+	arch_vm_t *vm = p;
+	aint first, last, i;
+
+	first = ((aint) addr - (aint) vm->start) >> PAGE_SHIFT;
+	last = ((aint) addr + size - 1 - (aint) vm->start) >> PAGE_SHIFT;
+
+	for (i = first; i <= last; i++)
+		if (vm->pt[i] & PTE_P)
+			break;
+
+	if (i > last)
+		return 0;
+	if (i == first)
+		return size;
+
+	return (aint) addr + size - ((aint) vm->start + (i << PAGE_SHIFT));
+}
+
+/*! Page pool usage */
+void arch_vm_pool_info(uint *used, uint *total)
+{
+	*used = pool_pages - pool_free;
+	*total = pool_pages;
+}
+
+/*! Load page directory of address space (if not already loaded) */
+void arch_vm_select(void *vm)
+{
+	if (vm && vm != vm_loaded)
+	{
+		load_cr3(((arch_vm_t *) vm)->pd);
+		vm_loaded = vm;
+	}
+}
+
+/*!
+ * Page fault handler: map zeroed page if faulting address is inside a process
+ * heap or stack. Fault on page present in other address space (kernel
+ * accessing memory of other process) is resolved by switching to its page
+ * directory.
+ * \return 0 if fault is resolved, error number otherwise
+ */
+int arch_vm_fault()
+{
+	aint addr = read_cr2();
+	arch_vm_t *vm;
+	uint32 *pte;
+	void *page;
+
+	if (addr < VM_START || addr >= VM_END)
+		return EFAULT;
+
+	vm = vm_slot[(addr - VM_START) >> PT_SHIFT];
+	if (!vm || addr - (aint) vm->start >= vm->size)
+		return EFAULT;
+
+	pte = &vm->pt[(addr - (aint) vm->start) >> PAGE_SHIFT];
+	if (!(*pte & PTE_P))
+	{
+		page = page_alloc();
+		if (!page)
+		{
+			LOG(WARN, "Page pool exhausted!\n");
+			return ENOMEM;
+		}
+		*pte = (uint32) page | PTE_P | PTE_W | PTE_U;
+		vm->pages++;
+	}
+	else if (vm == vm_loaded)
+	{
+		return EFAULT; /* mapped and loaded: not a missing page */
+	}
+
+	arch_vm_select(vm);
+
+	return EXIT_SUCCESS;
+}
+
+/*!
+ * Kernel wrote to shared (read only, XIP text) page of loaded address space,
+ * e.g. syscall got buffer in process text: give process its own copy of page
+ * (as if text was copied), shared module must stay unchanged
+ * \return 0 if fault is resolved, error number otherwise
+ */
+static int vm_unshare()
+{
+	aint addr = read_cr2();
+	arch_vm_t *vm = vm_loaded;
+	uint32 *pte;
+	void *page;
+
+	if (!vm || addr < (aint) vm->start ||
+	    addr - (aint) vm->start >= vm->size)
+		return EFAULT;
+
+	pte = &vm->pt[(addr - (aint) vm->start) >> PAGE_SHIFT];
+	if ((*pte & (PTE_P | PTE_SHARED)) != (PTE_P | PTE_SHARED))
+		return EFAULT;
+
+	page = page_alloc();
+	if (!page)
+	{
+		LOG(WARN, "Page pool exhausted!\n");
+		return ENOMEM;
+	}
+	memcpy(page, (void *) (*pte & PAGE_MASK), PAGE_SIZE);
+	*pte = (uint32) page | PTE_P | PTE_W | PTE_U;
+	vm->pages++;
+
+	load_cr3(vm->pd); /* flush TLB entry of shared page */
+
+	return EXIT_SUCCESS;
+}
+
+/*!
+ * Page fault in kernel mode (interrupt.S handles it on current stack, without
+ * saving thread context): kernel touched process memory
+ */
+void arch_vm_kernel_fault()
+{
+	if (arch_vm_fault() && vm_unshare())
+	{
+		LOG(ERROR, "PANIC: page fault in kernel (address %x)!\n",
+		      read_cr2());
+		halt();
+	}
+}
+
+#endif /* PAGING */
@@ -0,0 +1,56 @@
+/*! Paging: per process page directories, pages mapped on first touch */
+
+#pragma once
+
+#define PAGE_SHIFT	12
+#define PAGE_SIZE	(1 << PAGE_SHIFT)
+#define PAGE_MASK	(~(PAGE_SIZE - 1))
+
+#define PT_ENTRIES	1024	/* entries in page table or page directory */
+#define PT_SHIFT	22
+#define PT_SPAN		(1 << PT_SHIFT)	/* memory mapped with one page table */
+
+/* page directory and page table entry flags */
+#define PTE_P		0x001	/* present */
+#define PTE_W		0x002	/* writable */
+#define PTE_U		0x004	/* accessible from user mode */
+#define PTE_PWT		0x008	/* write through */
+#define PTE_PCD		0x010	/* cache disabled (device registers) */
+#define PTE_SHARED	0x200	/* (available to OS) page is not owned: XIP */
+
+/*
+ * Linear address space layout:
+ * - 0 - end of memory (from multiboot memory map, below VM_START): identity
+ *   mapped, kernel only (all page directories share the same page tables)
+ * - VM_START + i * PT_SPAN: window for i-th process; process segments
+ *   (SEGM_T_CODE/DATA) start at window start, so a process can't address
+ *   other windows; each window has its own page table
+ * - device registers (above memory, e.g. local APIC): identity mapped,
+ *   uncached, kernel only, shared as kernel memory (arch_paging_map_io)
+ */
+#define VM_START	0x40000000
+#define VM_SLOTS	64	/* max. number of processes */
+
+/* part of free memory (after modules) reserved for pages: 1/PAGE_POOL_PART */
+#define PAGE_POOL_PART	2
+
+#ifndef ASM_FILE
+
+#include <types/basic.h>
+
+/*! Process address space */
+typedef struct _arch_vm_t_
+{
+	uint32  *pd;	/* page directory */
+	uint32  *pt;	/* page table for process window */
+	void    *start;	/* window start (linear address) */
+	size_t   size;	/* process size (pages above are never mapped) */
+	uint     pages;	/* mapped pages */
+}
+arch_vm_t;
+
+void arch_paging_init(void *pool, size_t size, aint memory_end);
+void arch_paging_map_io(aint addr);
+void arch_vm_kernel_fault();
+
+#endif /* ASM_FILE */
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <types/basic.h>
+
 #define arch_disable_interrupts()	asm volatile ("cli\n\t")
 #define arch_enable_interrupts()	asm volatile ("sti\n\t")
 
@@ -15,4 +17,73 @@
 
 #define arch_memory_barrier()		asm ("" : : : "memory")
 
+/*
+ * Atomic operations on integer in memory (return previous value);
+ * cmpxchg and xadd require i486 or newer
+ */
+static inline int arch_atomic_cmpxchg(volatile int *ptr, int old, int new)
+{
+	int prev;
+
+	asm volatile (	"lock cmpxchgl %2, %1\n\t"
+			: "=a" (prev), "+m" (*ptr)
+			: "r" (new), "0" (old)
+			: "memory" );
+	return prev;
+}
+
+static inline int arch_atomic_xchg(volatile int *ptr, int value)
+{
+	asm volatile (	"xchgl %0, %1\n\t"
+			: "+r" (value), "+m" (*ptr)
+			:
+			: "memory" );
+	return value;
+}
+
+static inline int arch_atomic_add(volatile int *ptr, int value)
+{
+	asm volatile (	"lock xaddl %0, %1\n\t"
+			: "+r" (value), "+m" (*ptr)
+			:
+			: "memory" );
+	return value;
+}
+
+/*! Processor identification */
+#define CPUID_TSC		(1 << 4)	/* leaf 1, edx: rdtsc present */
+#define CPUID_MSR		(1 << 5)	/* leaf 1, edx: rdmsr present */
+#define CPUID_APIC		(1 << 9)	/* leaf 1, edx: local APIC */
+#define CPUID_EXT		0x80000000	/* eax: max. extended leaf */
+#define CPUID_EXT_POWER		0x80000007	/* power management leaf */
+#define CPUID_INVARIANT_TSC	(1 << 8)	/* in edx: TSC rate constant */
+
+static inline void arch_cpuid(uint32 leaf, uint32 *eax, uint32 *ebx,
+				uint32 *ecx, uint32 *edx)
+{
+	asm volatile (	"cpuid\n\t"
+			: "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+			: "a" (leaf), "c" (0) );
+}
+
+/*! Time stamp counter (Pentium or newer; check with cpuid first) */
+static inline uint64 arch_rdtsc()
+{
+	uint32 lo, hi;
+
+	asm volatile ("rdtsc\n\t" : "=a" (lo), "=d" (hi));
+
+	return ((uint64) hi << 32) | lo;
+}
+
+/*! Read model specific register (check with cpuid first) */
+static inline uint64 arch_rdmsr(uint32 msr)
+{
+	uint32 lo, hi;
+
+	asm volatile ("rdmsr\n\t" : "=a" (lo), "=d" (hi) : "c" (msr));
+
+	return ((uint64) hi << 32) | lo;
+}
+
 #include <arch/processor.h>
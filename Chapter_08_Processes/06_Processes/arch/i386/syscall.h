@@ -6,6 +6,7 @@
 
 #include <arch/context.h>
 #include <kernel/memory.h>
+#include "interrupt.h"
 
 /* syscall is from threads called as: int syscall(id, arg1, arg2, ...);
  *
@@ -13,17 +14,29 @@
  *	[return addres] [id] [arg1] [arg2] ...
  *
  * thread might be in its own address space - convert addresses if required
+ *
+ * with sysenter (FAST_SYSCALL) parameters are in registers, which are saved
+ * in thread context (interrupt.S: arch_sysenter) as:
+ *	esi = id; [ebp] [_esp] [ebx] [edx] [ecx] = [arg1] ... [arg5]
  */
 
 /*! Get syscall id from thread descriptor */
 static inline uint arch_syscall_get_id(context_t *cntx)
 {
+#ifdef FAST_SYSCALL
+	if (cntx->context.err == SYSENTER_FRAME)
+		return cntx->context.esi;
+#endif
 	return U2K_GET_INT((void *)(cntx->context.esp + 1), cntx->proc);
 }
 
 /*! Get address of first parameter to syscall (not including id) */
 static inline void *arch_syscall_get_params(context_t *cntx)
 {
+#ifdef FAST_SYSCALL
+	if (cntx->context.err == SYSENTER_FRAME)
+		return &cntx->context.ebp;
+#endif
 	return U2K_GET_ADR((void *)(cntx->context.esp + 2), cntx->proc);
 }
 
@@ -32,3 +45,15 @@ static inline void arch_syscall_set_retval(context_t *cntx, int retval)
 {
 	cntx->context.eax = retval;
 }
+
+/*! Can threads use fast syscall entry (sysenter)? */
+static inline int arch_syscall_fast()
+{
+#ifdef FAST_SYSCALL
+	extern uint32 arch_sysenter_supported; /* descriptor.c */
+
+	return arch_sysenter_supported;
+#else
+	return FALSE;
+#endif
+}
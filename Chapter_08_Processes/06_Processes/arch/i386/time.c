@@ -1,8 +1,10 @@
 /*! Timer in arch layer; use 'arch_timer_t' device defined in configuration */
 
 #include "time.h"
+#include "processor.h"
 
 #include <types/time.h>
+#include <types/bits.h>
 
 extern arch_timer_t TIMER;
 static arch_timer_t *timer = &TIMER;
@@ -13,11 +15,32 @@ static timespec_t last_load;/* last time equivalent loaded to counter */
 
 static timespec_t threshold;/* timer->min_interval / 2 */
 
+static uint interrupts;	/* number of timer interrupts (statistics) */
+
 static void (*alarm_handler)(); /* kernel function - call when alarm given by
 				    kernel ('delay') expires */
 
 static void arch_timer_handler(); /* whenever timer expires call this */
 
+#ifdef TSC_CLOCK
+/*!
+ * Time stamp counter as clock source: time is read from TSC (no port I/O),
+ * but only if TSC is invariant (constant rate); timer device still provides
+ * interrupts. TSC rate is measured with timer device at boot.
+ */
+#define TSC_CALIBRATE	50000000 /* ns; must be less than max_interval */
+
+static int tsc_used;		/* use TSC for time */
+static uint32 tsc_khz;		/* calibrated TSC frequency */
+static uint32 tsc_cal_cycles;	/* TSC cycles in ... */
+static uint32 tsc_cal_ns;	/* ... calibration interval */
+static uint64 tsc_base;		/* TSC value at time 'tsc_time' */
+static timespec_t tsc_time;
+
+static void tsc_init();
+static void tsc_get_time(timespec_t *time, int update_base);
+#endif /* TSC_CLOCK */
+
 void arch_enable_timer_interrupt()	{ timer->enable_interrupt();	}
 void arch_disable_timer_interrupt()	{ timer->disable_interrupt();	}
 
@@ -37,6 +60,9 @@ void arch_timer_init()
 	last_load = delay = timer->max_interval;
 
 	timer->set_interval(&last_load);
+#ifdef TSC_CLOCK
+	tsc_init(); /* restarts timer counter */
+#endif
 	timer->register_interrupt(arch_timer_handler);
 	timer->enable_interrupt();
 
@@ -83,6 +109,13 @@ void arch_get_time(timespec_t *time)
 {
 	timespec_t remainder;
 
+#ifdef TSC_CLOCK
+	if (tsc_used)
+	{
+		tsc_get_time(time, FALSE);
+		return;
+	}
+#endif
 	timer->get_interval_remainder(&remainder);
 
 	*time = last_load;
@@ -102,6 +135,10 @@ void arch_set_time(timespec_t *time)
 	clock = *time;
 	last_load = timer->max_interval;
 	timer->set_interval(&last_load);
+#ifdef TSC_CLOCK
+	tsc_base = arch_rdtsc();
+	tsc_time = *time;
+#endif
 
 	/* let kernel handle time shift problems */
 	if (alarm_handler)
@@ -120,7 +157,12 @@ static void arch_timer_handler()
 {
 	void (*k_handler)();
 
+	interrupts++;
 	time_add(&clock, &last_load);
+#ifdef TSC_CLOCK
+	if (tsc_used)
+		tsc_get_time(&tsc_time, TRUE); /* keep TSC difference small */
+#endif
 
 	if (alarm_handler)
 	{
@@ -148,3 +190,104 @@ static void arch_timer_handler()
 		}
 	}
 }
+
+/*! Get number of timer interrupts since power on */
+uint arch_timer_interrupts()
+{
+	return interrupts;
+}
+
+/*!
+ * Get TSC frequency (measured at boot)
+ * \param used Set if TSC is used as clock source (can be NULL)
+ * \return frequency in kHz, 0 if not measured
+ */
+uint arch_tsc_khz(int *used)
+{
+#ifdef TSC_CLOCK
+	if (used)
+		*used = tsc_used;
+	return tsc_khz;
+#else
+	if (used)
+		*used = FALSE;
+	return 0;
+#endif
+}
+
+#ifdef TSC_CLOCK
+/*! Check for TSC; measure its rate with timer device; use it if invariant */
+static void tsc_init()
+{
+	uint32 eax, ebx, ecx, edx, max_ext;
+	timespec_t rem, start, now;
+	uint64 tsc_start, tsc_now;
+
+	tsc_used = FALSE;
+	tsc_khz = 0;
+
+	arch_cpuid(1, &eax, &ebx, &ecx, &edx);
+	if (!(edx & CPUID_TSC))
+		return;
+
+	/* elapsed time is (counter is loaded with) last_load - remainder */
+	timer->set_interval(&last_load);
+	tsc_start = arch_rdtsc();
+	timer->get_interval_remainder(&rem);
+	start = last_load;
+	time_sub(&start, &rem);
+	do {
+		tsc_now = arch_rdtsc();
+		timer->get_interval_remainder(&rem);
+		now = last_load;
+		time_sub(&now, &rem);
+	}
+	while (now.tv_nsec < TSC_CALIBRATE);
+
+	time_sub(&now, &start);
+	tsc_cal_ns = now.tv_nsec;
+	tsc_cal_cycles = tsc_now - tsc_start;
+	tsc_khz = mul_div_32(tsc_cal_cycles, 1000000, tsc_cal_ns);
+
+	/* time counts from here */
+	timer->set_interval(&last_load);
+	tsc_base = arch_rdtsc();
+	tsc_time = clock;
+
+	arch_cpuid(CPUID_EXT, &max_ext, &ebx, &ecx, &edx);
+	if (max_ext >= CPUID_EXT_POWER)
+	{
+		arch_cpuid(CPUID_EXT_POWER, &eax, &ebx, &ecx, &edx);
+		tsc_used = (edx & CPUID_INVARIANT_TSC) != 0;
+	}
+}
+
+/*!
+ * Get time from TSC: 'tsc_time' + cycles from 'tsc_base'
+ * \param time Store address for current time
+ * \param update_base Move 'tsc_base' to now (and 'tsc_time' to 'time')
+ */
+static void tsc_get_time(timespec_t *time, int update_base)
+{
+	uint64 tsc, cycles;
+	timespec_t add;
+
+	tsc = arch_rdtsc();
+	cycles = tsc - tsc_base;
+	*time = tsc_time;
+
+	/* whole calibration intervals, then the rest (fits 32 bits) */
+	add.tv_sec = 0;
+	add.tv_nsec = tsc_cal_ns;
+	for (; cycles >= tsc_cal_cycles; cycles -= tsc_cal_cycles)
+		time_add(time, &add);
+	add.tv_nsec = mul_div_32((uint32) cycles, tsc_cal_ns, tsc_cal_cycles);
+	time_add(time, &add);
+
+	if (update_base)
+	{
+		tsc_base = tsc;
+		tsc_time = *time;
+	}
+}
+#endif /* TSC_CLOCK */
@@ -0,0 +1,69 @@
+/*! Minimal runtime for library code compiled as Linux (i386) program */
+
+#include <hostbench/host.h>
+#include <lib/string.h>
+
+#define HOST_WRITE		4	/* Linux i386 system call numbers */
+#define HOST_EXIT_GROUP		252
+#define HOST_CLOCK_GETTIME	265
+#define HOST_CLOCK_MONOTONIC	1
+
+#define PRINT_MAXLEN		256
+
+static int host_syscall(int id, int arg1, int arg2, int arg3)
+{
+	int retval;
+
+	asm volatile (	"int $0x80\n\t"
+			: "=a" (retval)
+			: "0" (id), "b" (arg1), "c" (arg2), "d" (arg3)
+			: "memory" );
+
+	return retval;
+}
+
+void _start()
+{
+	host_exit(hostbench());
+}
+
+void host_exit(int status)
+{
+	for (;;)
+		host_syscall(HOST_EXIT_GROUP, status, 0, 0);
+}
+
+/*! Formated output on standard output (lightweight version of 'printf') */
+void hprintf(char *format, ...)
+{
+	size_t size;
+	char buffer[PRINT_MAXLEN];
+
+	size = vssprintf(buffer, PRINT_MAXLEN, &format);
+	if (size > 0)
+		host_syscall(HOST_WRITE, 1, (int) buffer, size - 1); /* no '\0' */
+}
+
+void host_assert(char *file, int line)
+{
+	hprintf("[BUG:%s:%d]\n", file, line);
+	host_exit(2);
+}
+
+uint host_time_ns()
+{
+	struct { int tv_sec; int tv_nsec; } t;
+
+	host_syscall(HOST_CLOCK_GETTIME, HOST_CLOCK_MONOTONIC, (int) &t, 0);
+
+	return (uint) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+uint host_cycles()
+{
+	uint low, high;
+
+	asm volatile ("rdtsc\n\t" : "=a" (low), "=d" (high));
+
+	return low;
+}
@@ -0,0 +1,38 @@
+/*! Minimal runtime for library code compiled as Linux (i386) program
+ *
+ * Library code (lib/) is built with the same compiler flags as in kernel
+ * (freestanding, 32 bit), only ASSERT/LOG and entry point are provided here,
+ * using Linux system calls directly (no C library).
+ */
+#pragma once
+
+#include <types/basic.h>
+#include <types/errno.h>
+
+/*! program entry, return value is exit status */
+int hostbench();
+
+void hprintf(char *format, ...);
+void host_exit(int status);
+void host_assert(char *file, int line);
+
+/*! monotonic time in ns (32 bit: use only for intervals shorter than 4 s) */
+uint host_time_ns();
+
+/*! time stamp counter (lower 32 bits) */
+uint host_cycles();
+
+#ifdef DEBUG
+
+#define ASSERT(expr)	\
+do if (!(expr)) host_assert(__FILE__, __LINE__); while (0)
+
+#define LOG(LEVEL, format, ...)	\
+hprintf("[" #LEVEL ":%s:%d]" format "\n", __FILE__, __LINE__, ##__VA_ARGS__)
+
+#else /* !DEBUG */
+
+#define ASSERT(expr)
+#define LOG(LEVEL, format, ...)
+
+#endif /* DEBUG */
@@ -0,0 +1,886 @@
+/*! Tests and microbenchmarks for library code (lists, strings, allocators)
+ *
+ * Output is one result per line: "suite metric parameter value unit"
+ * (tests: "test name - ok|FAIL -"); exit status is number of failed tests.
+ */
+
+#include <hostbench/host.h>
+#include <lib/list.h>
+#include <lib/pheap.h>
+#include <lib/string.h>
+#include <lib/ff_simple.h>
+#include <lib/gma.h>
+#include <lib/lz4.h>
+#include <lib/slab.h>
+#include <types/bits.h>
+
+#define POOL_SIZE	(4 * 1024 * 1024)
+#define SLOTS		512	/* live allocations in churn */
+#define CHURN_OPS	200000	/* alloc/free operations per measurement */
+#define LIST_MAX	4096
+#define TIMERS		10000	/* armed timers in timer queue benchmark */
+
+static char pool[POOL_SIZE] __attribute__ ((aligned (16)));
+static char copy_buf[2][1024 * 1024];
+
+static int failed;
+
+static void report(char *suite, char *metric, char *param, uint value,
+		     char *unit)
+{
+	hprintf("%s %s %s %u %s\n", suite, metric, param, value, unit);
+}
+
+static void test_result(char *name, int ok)
+{
+	hprintf("test %s - %s -\n", name, ok ? "ok" : "FAIL");
+	if (!ok)
+		failed++;
+}
+
+/*! ns per operation (32 bit arithmetic; 'ns' must fit in 32 bits) */
+static uint per_op(uint ns, uint ops)
+{
+	return ops ? ns / ops : 0;
+}
+
+/*! Allocators ------------------------------------------------------------- */
+
+typedef struct _allocator_t_
+{
+	char   *name;
+	void   *(*init)(void *segment, size_t size);
+	void   *(*alloc)(void *mpool, size_t size);
+	int	(*free)(void *mpool, void *ptr);
+}
+allocator_t;
+
+static void *gma_init_default(void *segment, size_t size)
+{
+	return gma_init(segment, size, 32, 0); /* as in kernel */
+}
+
+static allocator_t allocators[] = {
+	{ "ff_simple", ffs_init, ffs_alloc, ffs_free },
+	{ "gma", gma_init_default, gma_alloc, gma_free },
+	{ NULL, NULL, NULL, NULL }
+};
+
+/*! request size distributions */
+static size_t size_small(uint *seed)
+{
+	return 8 + rand(seed) % 121; /* 8-128 */
+}
+static size_t size_kernel(uint *seed)
+{
+	/* descriptors, messages and occasional stack or buffer */
+	static size_t sizes[] = { 24, 32, 32, 48, 48, 64, 80, 96, 128, 256,
+				  1024, 4096 };
+
+	return sizes[rand(seed) % (sizeof(sizes) / sizeof(size_t))];
+}
+static size_t size_mixed(uint *seed)
+{
+	uint bits = 4 + rand(seed) % 11; /* 16 B - 32 KB, log-uniform */
+
+	return (1 << bits) + rand(seed) % (1 << bits);
+}
+
+typedef struct _size_mix_t_
+{
+	char	*name;
+	size_t	(*size)(uint *seed);
+}
+size_mix_t;
+
+static size_mix_t mixes[] = {
+	{ "small", size_small },
+	{ "kernel", size_kernel },
+	{ "mixed", size_mixed },
+	{ NULL, NULL }
+};
+
+static void *slot[SLOTS];
+static size_t slot_size[SLOTS];
+
+typedef struct _churn_stat_t_
+{
+	uint  fails;		/* failed allocations */
+	uint  max_cycles;	/* longest allocation */
+	uint  sum_cycles;	/* all allocations */
+	uint  allocs;		/* number of allocations */
+	uint  corrupted;	/* blocks with changed content */
+	uint  misaligned;	/* blocks not aligned on size_t */
+}
+churn_stat_t;
+
+static char pattern(int i)
+{
+	return (char) (i * 7 + 1);
+}
+
+static int block_intact(void *block, size_t size, char c)
+{
+	char *p = block;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		if (p[i] != c)
+			return FALSE;
+
+	return TRUE;
+}
+
+/*!
+ * Random allocations and releases in SLOTS slots: free if slot is used,
+ * allocate otherwise (with 'stat' allocations are timed, with 'verify'
+ * block contents are written and checked)
+ */
+static void churn(allocator_t *a, void *mpool, size_mix_t *mix, uint ops,
+		    uint *seed, churn_stat_t *stat, int verify)
+{
+	uint i, s, t;
+
+	for (i = 0; i < ops; i++)
+	{
+		s = rand(seed) % SLOTS;
+
+		if (slot[s])
+		{
+			if (verify && !block_intact(slot[s], slot_size[s],
+						    pattern(s)))
+				stat->corrupted++;
+
+			a->free(mpool, slot[s]);
+			slot[s] = NULL;
+			continue;
+		}
+
+		slot_size[s] = mix->size(seed);
+
+		if (stat)
+		{
+			t = host_cycles();
+			slot[s] = a->alloc(mpool, slot_size[s]);
+			t = host_cycles() - t;
+
+			stat->allocs++;
+			stat->sum_cycles += t;
+			if (t > stat->max_cycles)
+				stat->max_cycles = t;
+		}
+		else {
+			slot[s] = a->alloc(mpool, slot_size[s]);
+		}
+
+		if (!slot[s])
+		{
+			if (stat)
+				stat->fails++;
+			continue;
+		}
+
+		if (verify)
+		{
+			if ((aint) slot[s] & (sizeof(size_t) - 1))
+				stat->misaligned++;
+			memset(slot[s], pattern(s), slot_size[s]);
+		}
+	}
+}
+
+static void free_all(allocator_t *a, void *mpool)
+{
+	int s;
+
+	for (s = 0; s < SLOTS; s++)
+	{
+		if (slot[s])
+			a->free(mpool, slot[s]);
+		slot[s] = NULL;
+	}
+}
+
+/*! largest block that can be allocated (binary search) */
+static size_t largest_block(allocator_t *a, void *mpool)
+{
+	size_t low = 0, high = POOL_SIZE, mid;
+	void *p;
+
+	while (low + 1 < high)
+	{
+		mid = (low + high) / 2;
+		p = a->alloc(mpool, mid);
+		if (p)
+		{
+			a->free(mpool, p);
+			low = mid;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+static void test_allocator(allocator_t *a)
+{
+	char name[32];
+	void *mpool;
+	churn_stat_t stat = { 0 };
+	uint seed = 1;
+	size_mix_t *mix;
+	void *p;
+
+	mpool = a->init(pool, POOL_SIZE);
+
+	for (mix = mixes; mix->name; mix++)
+		churn(a, mpool, mix, CHURN_OPS / 4, &seed, &stat, TRUE);
+	free_all(a, mpool);
+
+	strcpy(name, a->name);
+	strcat(name, "_content");
+	test_result(name, !stat.corrupted);
+
+	strcpy(name, a->name);
+	strcat(name, "_align");
+	test_result(name, !stat.misaligned);
+
+	/* everything is free: neighbors must be joined again */
+	p = a->alloc(mpool, POOL_SIZE / 4 * 3);
+	strcpy(name, a->name);
+	strcat(name, "_coalesce");
+	test_result(name, p != NULL);
+}
+
+/*! first fit: growing used chunk in place (kernel, for process heap) */
+static void test_ffs_extend()
+{
+	void *mpool, *a, *b, *c;
+	int ok;
+
+	/* chunks are taken from end of free chunk: a > b > c */
+	mpool = ffs_init(pool, POOL_SIZE);
+	a = ffs_alloc(mpool, 1000);
+	b = ffs_alloc(mpool, 1000);
+	c = ffs_alloc(mpool, 1000);
+	memset(b, 2, 1000);
+	memset(c, 3, 1000);
+
+	ok = ffs_extend(mpool, b, 1000) == 0;	/* already large enough */
+	ok = ok && ffs_extend(mpool, b, 1500) == -1; /* 'a' is used */
+
+	ffs_free(mpool, a);
+	ok = ok && ffs_extend(mpool, b, 1500) == 0;
+	memset(b, 2, 1500);
+	ok = ok && ffs_extend(mpool, b, 10000) == -1; /* 'a' was last */
+	ok = ok && block_intact(c, 1000, 3);
+
+	/* rest of 'a' is still usable, and all joins when freed */
+	a = ffs_alloc(mpool, 300);
+	ok = ok && a > b && block_intact(b, 1500, 2);
+	ffs_free(mpool, a);
+	ffs_free(mpool, b);
+	ffs_free(mpool, c);
+	ok = ok && ffs_alloc(mpool, POOL_SIZE / 4 * 3) != NULL;
+
+	test_result("ff_simple_extend", ok);
+}
+
+/*! first fit: pool from non-contiguous regions */
+static void test_ffs_add()
+{
+	void *mpool, *a, *b;
+	size_t free, largest;
+	int ok;
+
+	/* regions: first quarter and second half of 'pool' (with a gap) */
+	mpool = ffs_init(pool, POOL_SIZE / 4);
+	ok = ffs_add(mpool, pool + POOL_SIZE / 2, POOL_SIZE / 2) == 0;
+	ok = ok && ffs_add(mpool, pool + POOL_SIZE / 4, 16) == -1;
+
+	/* larger than first region: from second one */
+	a = ffs_alloc(mpool, POOL_SIZE / 3);
+	b = ffs_alloc(mpool, POOL_SIZE / 8);
+	ok = ok && a >= (void *) pool + POOL_SIZE / 2 && b != NULL;
+
+	/* regions don't join when freed */
+	ffs_free(mpool, a);
+	ffs_free(mpool, b);
+	ffs_stat(mpool, &free, &largest);
+	ok = ok && largest < POOL_SIZE / 2 && free > POOL_SIZE / 2;
+
+	test_result("ff_simple_add", ok);
+}
+
+/*! first fit: moving used chunks down (kernel heap compaction) */
+static void test_ffs_alloc_below()
+{
+	void *mpool, *a, *b, *c, *d, *e, *moved;
+	size_t free, largest, free2, largest2;
+	int ok;
+
+	/* a > b > c > d > e, where 'e' takes rest of pool */
+	mpool = ffs_init(pool, POOL_SIZE);
+	a = ffs_alloc(mpool, 1000);
+	b = ffs_alloc(mpool, 1000);
+	c = ffs_alloc(mpool, 1000);
+	d = ffs_alloc(mpool, 1000);
+	ffs_stat(mpool, &free, &largest);
+	e = ffs_alloc(mpool, largest - 2 * sizeof(size_t));
+	memset(b, 2, 1000);
+	memset(d, 4, 1000);
+
+	/* free 'a' and 'c': two holes */
+	ffs_free(mpool, a);
+	ffs_free(mpool, c);
+	ffs_stat(mpool, &free, &largest);
+
+	ok = e != NULL && free == 2 * largest;
+	ok = ok && ffs_alloc_below(mpool, 1000, d) == NULL; /* none below */
+
+	/* move 'b' into hole left by 'c': then 'b' and 'a' join */
+	moved = ffs_alloc_below(mpool, 1000, b);
+	ok = ok && moved == c;
+	memcpy(moved, b, 1000);
+	ffs_free(mpool, b);
+	ffs_stat(mpool, &free2, &largest2);
+
+	ok = ok && free2 == free && largest2 == free;
+	ok = ok && block_intact(moved, 1000, 2) && block_intact(d, 1000, 4);
+
+	ffs_free(mpool, moved);
+	ffs_free(mpool, d);
+	ffs_free(mpool, e);
+	ffs_stat(mpool, &free2, &largest2);
+	ok = ok && free2 == largest2;
+
+	test_result("ff_simple_alloc_below", ok);
+}
+
+static void bench_allocator(allocator_t *a)
+{
+	void *mpool;
+	churn_stat_t stat;
+	uint seed, t, live;
+	size_t largest;
+	size_mix_t *mix;
+	int s;
+
+	for (mix = mixes; mix->name; mix++)
+	{
+		/* throughput: warm up to steady state, then measure */
+		mpool = a->init(pool, POOL_SIZE);
+		seed = 1;
+		churn(a, mpool, mix, CHURN_OPS, &seed, NULL, FALSE);
+
+		t = host_time_ns();
+		churn(a, mpool, mix, CHURN_OPS, &seed, NULL, FALSE);
+		t = host_time_ns() - t;
+		report(a->name, "alloc_free_ns", mix->name,
+			per_op(t, CHURN_OPS), "ns");
+
+		/* latency of single allocation */
+		stat = (churn_stat_t) { 0 };
+		churn(a, mpool, mix, CHURN_OPS, &seed, &stat, FALSE);
+		report(a->name, "alloc_avg_cycles", mix->name,
+			per_op(stat.sum_cycles, stat.allocs), "cycles");
+		report(a->name, "alloc_max_cycles", mix->name,
+			stat.max_cycles, "cycles");
+		report(a->name, "alloc_fails", mix->name, stat.fails, "count");
+
+		/* fragmentation: largest free block compared to free memory */
+		live = 0;
+		for (s = 0; s < SLOTS; s++)
+			if (slot[s])
+				live += slot_size[s];
+		largest = largest_block(a, mpool);
+		report(a->name, "live_kb", mix->name, live / 1024, "KB");
+		report(a->name, "largest_free_kb", mix->name, largest / 1024,
+			"KB");
+		report(a->name, "fragmentation", mix->name,
+			100 - largest / ((POOL_SIZE - live) / 100), "pct");
+
+		free_all(a, mpool);
+	}
+}
+
+/*! Object cache (on top of first fit) ------------------------------------- */
+
+static void *slab_mpool;
+static uint ctor_calls;
+
+static void *slab_backing_alloc(size_t size)
+{
+	return ffs_alloc(slab_mpool, size);
+}
+
+static void slab_ctor(void *obj)
+{
+	ctor_calls++;
+	memset(obj, 0x5a, 64);
+}
+
+static void test_slab()
+{
+	slab_cache_t cache;
+	void *obj[100], *again;
+	int i, ok = TRUE;
+
+	slab_mpool = ffs_init(pool, POOL_SIZE);
+	slab_cache_init(&cache, "test", 64, slab_ctor, slab_backing_alloc);
+
+	for (i = 0; i < 100; i++)
+	{
+		obj[i] = slab_alloc(&cache);
+		if (!obj[i] || !block_intact(obj[i], 64, 0x5a))
+			ok = FALSE;
+		memset(obj[i], i, 64); /* must not overwrite neighbors */
+	}
+	for (i = 0; i < 100; i++)
+		if (!block_intact(obj[i], 64, i))
+			ok = FALSE;
+
+	test_result("slab_alloc", ok);
+	test_result("slab_ctor", ctor_calls == cache.slabs * cache.slab_objs);
+
+	slab_free(&cache, obj[42]);
+	again = slab_alloc(&cache);
+	test_result("slab_reuse", again == obj[42] &&
+		    block_intact(again, 64, 42) && cache.in_use == 100);
+}
+
+static void bench_slab()
+{
+	slab_cache_t cache;
+	uint seed = 1, i, s, t;
+
+	slab_mpool = ffs_init(pool, POOL_SIZE);
+	slab_cache_init(&cache, "bench", 64, NULL, slab_backing_alloc);
+
+	for (i = 0; i < SLOTS; i++)
+		slot[i] = NULL;
+
+	t = host_time_ns();
+	for (i = 0; i < CHURN_OPS; i++)
+	{
+		s = rand(&seed) % SLOTS;
+		if (slot[s])
+		{
+			slab_free(&cache, slot[s]);
+			slot[s] = NULL;
+		}
+		else {
+			slot[s] = slab_alloc(&cache);
+		}
+	}
+	t = host_time_ns() - t;
+
+	for (i = 0; i < SLOTS; i++)
+		slot[i] = NULL;
+
+	report("slab", "alloc_free_ns", "64", per_op(t, CHURN_OPS), "ns");
+}
+
+/*! Strings ---------------------------------------------------------------- */
+
+static void test_string()
+{
+	char a[64], b[64], buf[20];
+	int i, ok;
+
+	for (i = 0; i < 64; i++)
+		a[i] = (char) i;
+
+	memcpy(b, a, 64);
+	test_result("memcpy", !memcmp(a, b, 64));
+
+	/* overlapping, forward and backward */
+	memmove(b + 8, b, 32);
+	ok = TRUE;
+	for (i = 0; i < 32; i++)
+		if (b[i + 8] != a[i])
+			ok = FALSE;
+	memcpy(b, a, 64);
+	memmove(b, b + 8, 32);
+	for (i = 0; i < 32; i++)
+		if (b[i] != a[i + 8])
+			ok = FALSE;
+	test_result("memmove", ok);
+
+	memcpy(b, a, 64);
+	memset(b, 'x', 10);
+	test_result("memset", block_intact(b, 10, 'x') && b[10] == 10);
+
+	test_result("memcmp", memcmp(a, b, 64) < 0 && memcmp(b, a, 64) > 0);
+
+	strcpy(b, "hello");
+	strcat(b, " world");
+	test_result("strcpy_strcat", !strcmp(b, "hello world") &&
+		    strlen(b) == 11);
+	test_result("strcmp", strcmp("abc", "abd") < 0 &&
+		    strcmp("abd", "abc") > 0 && !strncmp("abcx", "abcy", 3));
+	test_result("strchr_strstr", strchr(b, 'w') == b + 6 &&
+		    strstr(b, "lo w") == b + 3 && !strstr(b, "xyz"));
+
+	itoa(buf, 'd', -1234);
+	ok = !strcmp(buf, "-1234");
+	itoa(buf, 'x', 0xbeef);
+	ok = ok && !strcmp(buf, "0x0000beef");
+	test_result("itoa", ok);
+}
+
+static void bench_memcpy()
+{
+	static uint sizes[] = { 16, 64, 256, 1024, 4096, 65536, 1048576, 0 };
+	char param[16];
+	uint i, n, rounds, t;
+
+	for (i = 0; sizes[i]; i++)
+	{
+		/* copy 64 MB with each block size */
+		rounds = (64 * 1024 * 1024) / sizes[i];
+
+		t = host_time_ns();
+		for (n = 0; n < rounds; n++)
+			memcpy(copy_buf[n & 1], copy_buf[(n + 1) & 1],
+				sizes[i]);
+		t = host_time_ns() - t;
+
+		itoa(param, 'd', sizes[i]);
+		/* MB/s = 64 MB / (t / 10^9 s) */
+		report("memcpy", "bandwidth", param,
+			t ? mul_div_32(64, 1000000000, t) : 0, "MB/s");
+	}
+}
+
+/*! Decompression ---------------------------------------------------------- */
+
+static void test_lz4()
+{
+	/* literals only */
+	static uint8 lit[] = { 0x50, 'h', 'e', 'l', 'l', 'o' };
+	/* 'a', then 29 byte match from offset 1 (overlapping), empty last */
+	static uint8 rle[] = { 0x1f, 'a', 1, 0, 10, 0x00 };
+	/* 20 literals (length continues in next byte) */
+	static uint8 lit20[] = { 0xf0, 5, '0', '1', '2', '3', '4', '5', '6',
+		'7', '8', '9', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	/* malformed: offset 0, offset before start, literals cut off */
+	static uint8 off0[] = { 0x10, 'a', 0, 0, 0x00 };
+	static uint8 off2[] = { 0x10, 'a', 2, 0, 0x00 };
+	static uint8 cut[] = { 0x50, 'h', 'e' };
+	char out[64];
+	int i, ok;
+
+	ok = lz4_decompress(lit, sizeof(lit), out, 64) == 5 &&
+		!memcmp(out, "hello", 5);
+	ok = ok && lz4_decompress(lit, sizeof(lit), out, 4) == -1;
+	test_result("lz4_literals", ok);
+
+	ok = lz4_decompress(rle, sizeof(rle), out, 64) == 30;
+	for (i = 0; i < 30; i++)
+		if (out[i] != 'a')
+			ok = FALSE;
+	ok = ok && lz4_decompress(rle, sizeof(rle), out, 29) == -1;
+	test_result("lz4_overlap", ok);
+
+	ok = lz4_decompress(lit20, sizeof(lit20), out, 64) == 20 &&
+		!memcmp(out, "01234567890123456789", 20);
+	test_result("lz4_long_length", ok);
+
+	ok = lz4_decompress(off0, sizeof(off0), out, 64) == -1 &&
+		lz4_decompress(off2, sizeof(off2), out, 64) == -1 &&
+		lz4_decompress(cut, sizeof(cut), out, 64) == -1;
+	test_result("lz4_corrupted", ok);
+}
+
+/*!
+ * Build compressed block: 8 literals and 18 byte match (from offset up to
+ * 4 KB back) until 'size' bytes of output
+ * \return compressed size
+ */
+static size_t lz4_sample(uint8 *dst, size_t size)
+{
+	uint8 *op = dst;
+	size_t out = 0, offset;
+	uint seed = 1, i;
+
+	while (out + 8 + 18 <= size)
+	{
+		*op++ = (8 << 4) | (18 - 4);
+		for (i = 0; i < 8; i++)
+			*op++ = (seed = seed * 1103515245 + 12345) >> 16;
+		out += 8;
+
+		offset = 1 + (seed >> 8) % (out < 4096 ? out : 4096);
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		out += 18;
+	}
+	*op++ = 0; /* last sequence, without literals */
+
+	return op - dst;
+}
+
+static void bench_lz4()
+{
+	size_t packed, size = sizeof(copy_buf[1]);
+	uint n, t;
+
+	packed = lz4_sample((uint8 *) copy_buf[0], size);
+
+	t = host_time_ns();
+	for (n = 0; n < 64; n++)
+		if (lz4_decompress(copy_buf[0], packed, copy_buf[1], size) < 0)
+			break;
+	t = host_time_ns() - t;
+
+	test_result("lz4_sample", n == 64);
+
+	/* MB/s of output: 64 MB / (t / 10^9 s) */
+	report("lz4", "decompress", "1048576",
+		t ? mul_div_32(64, 1000000000, t) : 0, "MB/s");
+}
+
+/*! Lists ------------------------------------------------------------------ */
+
+typedef struct _item_t_
+{
+	int	key;
+	list_h	list;
+	pheap_h	heap;
+}
+item_t;
+
+static item_t items[TIMERS + 1]; /* (TIMERS > LIST_MAX) */
+
+static int item_cmp(void *a, void *b)
+{
+	return ((item_t *) a)->key - ((item_t *) b)->key;
+}
+
+static void test_list()
+{
+	list_t list;
+	item_t *it, *prev;
+	uint seed = 1;
+	int i, ok = TRUE;
+
+	list_init(&list);
+	for (i = 0; i < 3; i++)
+		items[i].key = i;
+	list_append(&list, &items[1], &items[1].list);
+	list_prepend(&list, &items[0], &items[0].list);
+	list_append(&list, &items[2], &items[2].list);
+
+	for (i = 0, it = list_get(&list, FIRST); it;
+	     i++, it = list_get_next(&it->list))
+		if (it != &items[i])
+			ok = FALSE;
+	ok = ok && i == 3 && list_get(&list, LAST) == &items[2];
+	ok = ok && list_find(&list, &items[1].list) != NULL;
+	ok = ok && list_remove(&list, 0, &items[1].list) == &items[1];
+	ok = ok && !list_find(&list, &items[1].list);
+	ok = ok && list_remove(&list, LAST, NULL) == &items[2];
+	ok = ok && list_remove(&list, FIRST, NULL) == &items[0];
+	ok = ok && !list_get(&list, FIRST);
+	test_result("list", ok);
+
+	list_init(&list);
+	for (i = 0; i < 1000; i++)
+	{
+		items[i].key = rand(&seed) % 100;
+		list_sort_add(&list, &items[i], &items[i].list, item_cmp);
+	}
+	ok = TRUE;
+	prev = NULL;
+	for (i = 0, it = list_get(&list, FIRST); it;
+	     i++, it = list_get_next(&it->list))
+	{
+		if (prev && (prev->key > it->key ||
+			     (prev->key == it->key && prev > it)))
+			ok = FALSE; /* not sorted or not stable */
+		prev = it;
+	}
+	test_result("list_sort_add", ok && i == 1000);
+}
+
+static void bench_list()
+{
+	static uint lengths[] = { 8, 64, 512, LIST_MAX, 0 };
+	list_t list;
+	item_t *it = &items[LIST_MAX];
+	char param[16];
+	uint seed = 1, i, n, t, rounds;
+
+	for (i = 0; lengths[i]; i++)
+	{
+		list_init(&list);
+		for (n = 0; n < lengths[i]; n++)
+		{
+			items[n].key = rand(&seed);
+			list_sort_add(&list, &items[n], &items[n].list,
+					item_cmp);
+		}
+
+		/* insert into list with given length, then remove */
+		rounds = 4 * 1024 * 1024 / lengths[i];
+		t = host_time_ns();
+		for (n = 0; n < rounds; n++)
+		{
+			it->key = rand(&seed);
+			list_sort_add(&list, it, &it->list, item_cmp);
+			list_remove(&list, 0, &it->list);
+		}
+		t = host_time_ns() - t;
+
+		itoa(param, 'd', lengths[i]);
+		report("list", "sort_add_ns", param, per_op(t, rounds), "ns");
+	}
+}
+
+/*! Timer queue: sorted list or pairing heap ------------------------------- */
+
+/*! By expiration, then by address (as sequence number for kernel timers) */
+static int timer_cmp(void *_a, void *_b)
+{
+	item_t *a = _a, *b = _b;
+
+	if (a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+
+	return a < b ? -1 : (a > b);
+}
+
+static void test_pheap()
+{
+	pheap_t heap;
+	item_t *it, *prev;
+	uint seed = 1;
+	int i, n, ok = TRUE;
+
+	pheap_init(&heap, timer_cmp);
+	ok = !pheap_get_first(&heap) && !pheap_remove_first(&heap);
+
+	for (i = 0; i < 1000; i++)
+	{
+		items[i].key = rand(&seed) % 100;
+		pheap_add(&heap, &items[i], &items[i].heap);
+	}
+
+	/* remove every third element (from anywhere in heap) */
+	for (i = 0; i < 1000; i += 3)
+		ok = ok && pheap_remove(&heap, &items[i].heap) == &items[i];
+
+	prev = NULL;
+	for (n = 0; (it = pheap_remove_first(&heap)); n++)
+	{
+		if ((it - items) % 3 == 0 || (prev && timer_cmp(prev, it) > 0))
+			ok = FALSE; /* removed or not in order */
+		prev = it;
+	}
+	test_result("pheap", ok && n == 1000 - 334);
+}
+
+/*!
+ * Timer queue with TIMERS armed timers: arm all, re-arm first (periodic
+ * timers), cancel all (in random order); per operation cost
+ */
+static void bench_timers()
+{
+	list_t list;
+	pheap_t heap;
+	item_t *it;
+	uint seed, i, t_arm, t_rearm, t_cancel;
+	int q;
+
+	for (q = 0; q < 2; q++)
+	{
+		list_init(&list);
+		pheap_init(&heap, timer_cmp);
+
+		seed = 1;
+		for (i = 0; i < TIMERS; i++)
+			items[i].key = rand(&seed) % 1000000;
+
+		t_arm = host_time_ns();
+		for (i = 0; i < TIMERS; i++)
+			if (q)
+				pheap_add(&heap, &items[i], &items[i].heap);
+			else
+				list_sort_add(&list, &items[i], &items[i].list,
+						timer_cmp);
+		t_arm = host_time_ns() - t_arm;
+
+		t_rearm = host_time_ns();
+		for (i = 0; i < TIMERS; i++)
+		{
+			if (q)
+			{
+				it = pheap_remove_first(&heap);
+				it->key += 1000 + rand(&seed) % 100000;
+				pheap_add(&heap, it, &it->heap);
+			}
+			else {
+				it = list_remove(&list, FIRST, NULL);
+				it->key += 1000 + rand(&seed) % 100000;
+				list_sort_add(&list, it, &it->list, timer_cmp);
+			}
+		}
+		t_rearm = host_time_ns() - t_rearm;
+
+		t_cancel = host_time_ns();
+		for (i = 0; i < TIMERS; i++)
+		{
+			/* (visits all elements, but in scattered order) */
+			it = &items[(i * 7919) % TIMERS];
+			if (q)
+				pheap_remove(&heap, &it->heap);
+			else
+				list_remove(&list, 0, &it->list);
+		}
+		t_cancel = host_time_ns() - t_cancel;
+
+		report("timers", "arm_ns", q ? "pheap" : "list",
+			per_op(t_arm, TIMERS), "ns");
+		report("timers", "rearm_ns", q ? "pheap" : "list",
+			per_op(t_rearm, TIMERS), "ns");
+		report("timers", "cancel_ns", q ? "pheap" : "list",
+			per_op(t_cancel, TIMERS), "ns");
+	}
+}
+
+/*! ------------------------------------------------------------------------ */
+
+int hostbench()
+{
+	allocator_t *a;
+
+	hprintf("# suite metric parameter value unit\n");
+
+	/* touch all memory first: page faults are not allocation latency */
+	memset(pool, 0, POOL_SIZE);
+	memset(copy_buf, 0, sizeof(copy_buf));
+
+	test_list();
+	test_pheap();
+	test_string();
+	test_lz4();
+	for (a = allocators; a->name; a++)
+		test_allocator(a);
+	test_ffs_add();
+	test_ffs_extend();
+	test_ffs_alloc_below();
+	test_slab();
+
+	for (a = allocators; a->name; a++)
+		bench_allocator(a);
+	bench_slab();
+	bench_memcpy();
+	bench_lz4();
+	bench_list();
+	bench_timers();
+
+	return failed;
+}
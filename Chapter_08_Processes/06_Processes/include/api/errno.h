@@ -2,23 +2,26 @@
 #pragma once
 
 #include <types/errno.h>
-#include <api/syscall.h>
+#include <types/pthread.h>
+#include <arch/context.h>
+
+/* errno is in thread local storage (set by kernel on errors) */
+#define ERRNO_OFFSET	__builtin_offsetof(pthread_tls_t, errno)
 
 static inline int set_errno(int error_number)
 {
-	return syscall(SET_ERRNO, error_number);
+	arch_tls_set(ERRNO_OFFSET, (void *) error_number);
+	return 0;
 }
 static inline int get_errno()
 {
-	return syscall(GET_ERRNO);
+	return (int) arch_tls_get(ERRNO_OFFSET);
 }
 
 static inline int *get_errno_ptr()
 {
-	int *error_number_ptr;
-	syscall(GET_ERRNO_PTR, &error_number_ptr);
-
-	return error_number_ptr;
+	return arch_tls_get(__builtin_offsetof(pthread_tls_t, self)) +
+		ERRNO_OFFSET;
 }
 
 /*! errno via macro "_errno" */
@@ -1,4 +1,15 @@
-/*! Dynamic memory allocator */
+/*! Dynamic memory allocator
+ *
+ * Small requests (up to MALLOC_SMALL_MAX bytes) are rounded up to a size class
+ * and served from thread's own cache of free blocks, without locking and
+ * without searching. Caches are refilled from (and overflow into) shared
+ * per-class lists in batches. Larger requests go directly to back end
+ * allocator (GMA or first fit), protected with a mutex.
+ *
+ * Back end starts with heap reserved for program (HEAP_SIZE in config.ini);
+ * when it is exhausted, heap is extended with sbrk and new part is added as
+ * another back end pool.
+ */
 #pragma once
 
 #include <lib/ff_simple.h>
@@ -7,26 +18,42 @@
 
 extern process_t *_uproc_;
 
+/*! Back end allocator (on process heap) */
 #if MEM_ALLOCATOR_FOR_USER == FIRST_FIT
 
 #define MEM_ALLOC_T ffs_mpool_t
 
 #define	mem_init(segment, size)		ffs_init(segment, size)
-#define	malloc(size)			ffs_alloc(_uproc_->mpool, size)
-#define	free(addr)			ffs_free(_uproc_->mpool, addr)
+#define	mem_alloc(pool, size)		ffs_alloc(pool, size)
+#define	mem_free(pool, addr)		ffs_free(pool, addr)
 
 #elif MEM_ALLOCATOR_FOR_USER == GMA
 
 #define MEM_ALLOC_T gma_t
 
-#define	mem_init(segment, size)		gma_init(segment, size, 32, 0)
-#define	malloc(size)			gma_alloc(_uproc_->mpool, size)
-#define	free(addr)			gma_free(_uproc_->mpool, addr)
+#define	mem_init(segment, size)		gma_init(segment, size, 32, NEW_MPOOL)
+#define	mem_alloc(pool, size)		gma_alloc(pool, size)
+#define	mem_free(pool, addr)		gma_free(pool, addr)
 
 #else /* memory allocator not selected! */
 
 #define	mem_init			k_mem_init_Not_Implemented
-#define	malloc				k_mem_alloc_Not_Implemented
-#define	free				k_mem_free_Not_Implemented
+#define	mem_alloc			k_mem_alloc_Not_Implemented
+#define	mem_free			k_mem_free_Not_Implemented
 
 #endif
+
+#define MALLOC_SMALL_MAX	512	/* largest request served from caches */
+#define MALLOC_HEAPS		16	/* initial heap + parts added with sbrk */
+#define MALLOC_HEAP_GROW	0x4000	/* minimal heap extension */
+
+void malloc_init(void *heap, size_t size);
+void *sbrk(int increment);
+
+void *malloc(size_t size);
+void free(void *ptr);
+void *calloc(size_t nmemb, size_t size);
+void *realloc(void *ptr, size_t size);
+void *memalign(size_t alignment, size_t size);
+
+void malloc_thread_exit();
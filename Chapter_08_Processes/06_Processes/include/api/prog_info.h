@@ -34,6 +34,10 @@ typedef struct _program_t_
 	size_t  heap_size;
 	size_t  stack_size;
 	size_t  thread_stack;
+
+	/* Instructions (page aligned when compiled with XIP) */
+	void   *text;
+	void   *text_end;
 }
 program_t;
 
@@ -49,6 +53,11 @@ typedef struct _process_t_
 	void   *stack;
 	void   *mpool;
 
+	int     fast_syscall;	/* set by kernel: faster syscall available */
+
+	void   *malloc_reclaim;	/* set by kernel: malloc caches of threads
+				 * ended without pthread_exit (api/malloc.c) */
+
 	//void   *heap_brk;
 
 	/*
@@ -66,5 +75,9 @@ process_t;
  * |                .text, .*data*, .bss, ... (compiled sections)             |
  * +--------------------------------------------------------------------------+
  *
- * Heap and stack are added when program is started and becomes process
+ * With XIP, .text starts and ends on page boundary, so its pages in module
+ * can be shared by all processes started from it (PAGING is required).
+ *
+ * Stack and heap (in that order) are added when program is started and
+ * becomes process; heap is last so it can be extended (sbrk)
  */
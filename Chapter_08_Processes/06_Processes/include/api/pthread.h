@@ -23,6 +23,20 @@ int pthread_setschedparam(pthread_t thread, int policy,
 int pthread_getschedparam(pthread_t thread, int *policy,
 			    struct sched_param *param);
 
+/*! EDF scheduling (for calling thread) */
+int edf_set(timespec_t deadline, timespec_t period, int flags);
+int edf_wait();
+int edf_exit();
+
+/*! Thread specific data */
+int pthread_key_create(pthread_key_t *key, void (*destructor)(void *));
+int pthread_key_delete(pthread_key_t key);
+void *pthread_getspecific(pthread_key_t key);
+int pthread_setspecific(pthread_key_t key, void *value);
+
+/*! Thread properties (PR_SET_TIMERSLACK, PR_GET_TIMERSLACK) */
+int prctl(int option, long arg);
+
 /*! Create process */
 int posix_spawn(pid_t *pid, char *path, void *file_actions,
 		  void *attrp, char *argv[], char *envp[]);
@@ -35,6 +49,12 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex);
 
 int pthread_mutexattr_init(pthread_mutexattr_t *attr);
 int pthread_mutexattr_destroy(pthread_mutexattr_t *attr);
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol);
+int pthread_mutexattr_getprotocol(pthread_mutexattr_t *attr, int *protocol);
+int pthread_mutexattr_setprioceiling(pthread_mutexattr_t *attr,
+				       int prioceiling);
+int pthread_mutexattr_getprioceiling(pthread_mutexattr_t *attr,
+				       int *prioceiling);
 
 /*! Condition variable */
 int pthread_cond_init(pthread_cond_t *cond, pthread_condattr_t *attr);
@@ -43,6 +63,9 @@ int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
 int pthread_cond_signal(pthread_cond_t *cond);
 int pthread_cond_broadcast(pthread_cond_t *cond);
 
+/* on broadcast, move waiters to mutex queue instead of waking them all */
+extern int cond_requeue;
+
 int pthread_condattr_init(pthread_condattr_t *attr);
 int pthread_condattr_destroy(pthread_condattr_t *attr);
 int pthread_attr_setschedpolicy(pthread_attr_t *attr, int policy);
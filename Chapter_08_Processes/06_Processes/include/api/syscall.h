@@ -6,6 +6,9 @@
 
 extern int syscall(uint id, ...) __attribute__((noinline));
 
+/* use faster syscall entry (if available, up to 5 arguments)? */
+extern int syscall_fast;
+
 static inline uint sys_feature(uint features, int cmd, int enable)
 {
 	return syscall(SYSFEATURE, features, cmd, enable);
@@ -20,12 +20,18 @@ void arch_create_thread_context(
 	void *proc
 );
 
+/*! Set thread local storage (TLS) location for thread context */
+void arch_set_thread_tls(context_t *context, void *tls, size_t size);
+
 /*! Cleanups on context when deleting thread */
 void arch_destroy_thread_context(context_t *context);
 
 /*! Select thread to return to from interrupt (from syscall) */
 void arch_select_thread(context_t *cntx);
 
+/*! Get number of thread switches and process segments reloads */
+void arch_context_stats(uint *switches, uint *segm_reloads);
+
 /*!
  * For 'user threads' (in programs) (use inline, they are included from program)
  */
@@ -41,4 +47,8 @@ static inline void arch_create_uthread_context(
 
 static inline void arch_switch_to_uthread(ucontext_t *from, ucontext_t *to);
 
+/*! Access thread local storage (TLS) of active thread (from within thread) */
+static inline void *arch_tls_get(uint offset);
+static inline void arch_tls_set(uint offset, void *value);
+
 #include <ARCH/context.h> /* for context_t and ucontext_t */
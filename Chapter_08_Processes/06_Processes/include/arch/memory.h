@@ -9,6 +9,8 @@ enum {
 	MS_PROGRAM,
 	MS_PROCESS,
 	MS_OTHER,
+	MS_PAGES,
+	MS_PROGRAM_LZ,
 	MS_END
 };
 
@@ -23,6 +25,20 @@ mseg_t;
 
 mseg_t *arch_memory_init();
 
+#ifdef PAGING
+/*! Process address spaces (paging) */
+void *arch_vm_create(size_t size, void *image, size_t image_size,
+		       size_t text, size_t text_end);
+void arch_vm_destroy(void *vm);
+int arch_vm_resize(void *vm, size_t size);
+void *arch_vm_start(void *vm);
+uint arch_vm_pages(void *vm);
+size_t arch_vm_mapped_top(void *vm, void *addr, size_t size);
+void arch_vm_pool_info(uint *used, uint *total);
+void arch_vm_select(void *vm);
+int arch_vm_fault();
+#endif
+
 
 /*! modules in system images */
 /* magic numbers for headers */
@@ -36,7 +52,7 @@ typedef struct _module_t_
 		/* magic numbers to identify start of module */
 
 	uint32  type;
-		/* MS_PROGRAM, MS_OTHER */
+		/* MS_PROGRAM, MS_PROGRAM_LZ, MS_OTHER */
 
 	/* for calculating size */
 	void   *start;
@@ -63,6 +79,23 @@ typedef struct program_loaded_as_module
 }
 module_program_t;
 
+/* compressed program, created with tools/lzpack (numbers must match!) */
+typedef struct _module_packed_t_
+{
+	module_t  mod;
+		  /* type is MS_PROGRAM_LZ; end - start is packed size */
+
+	uint32    size;
+		  /* program size (when unpacked) */
+	uint32    raw_size;
+		  /* program start (header) that isn't compressed */
+	uint32    lz_size;
+		  /* rest of program: LZ4 block size */
+
+	/* after this header: raw_size bytes of program, then LZ4 block */
+}
+module_packed_t;
+
 /*
  * Memory map of module: (addresses grows downward!)
  * +--------------------------------------------------------------------------+
@@ -78,4 +111,13 @@ module_program_t;
  * +--------------------------------------------------------------------------+
  * |                .text, .*data*, .bss, ... (compiled sections)             |
  * +--------------------------------------------------------------------------+
+ *
+ * Compressed program (unpacked when process is started):
+ * +--------------------------------------------------------------------------+
+ * |                          module_packed_t header                          |
+ * +--------------------------------------------------------------------------+
+ * |            program start (with its header), not compressed               |
+ * +--------------------------------------------------------------------------+
+ * |                  rest of program, compressed (LZ4 block)                 |
+ * +--------------------------------------------------------------------------+
  */
@@ -20,4 +20,57 @@
 /* This should be in %eax. */
 #define MULTIBOOT_BOOTLOADER_MAGIC	0x2BADB002
 
+/* Flags in multiboot information structure: which fields are valid */
+#define MULTIBOOT_INFO_MEMORY	0x00000001	/* mem_lower, mem_upper */
+#define MULTIBOOT_INFO_MODS	0x00000008	/* mods_count, mods_addr */
+#define MULTIBOOT_INFO_MEM_MAP	0x00000040	/* mmap_length, mmap_addr */
+
+/* Memory map entry type for usable memory */
+#define MULTIBOOT_MEMORY_AVAILABLE	1
+
+#ifndef ASM_FILE
+
+#include <types/basic.h>
+
+/*! Multiboot information structure (address in %ebx at startup) */
+typedef struct _multiboot_info_t_
+{
+	uint32  flags;
+	uint32  mem_lower;	/* KB of memory below 1 MB */
+	uint32  mem_upper;	/* KB of memory above 1 MB (to first hole) */
+	uint32  boot_device;
+	uint32  cmdline;
+	uint32  mods_count;
+	uint32  mods_addr;	/* array of multiboot_module_t */
+	uint32  syms[4];
+	uint32  mmap_length;
+	uint32  mmap_addr;	/* list of multiboot_mmap_t */
+}
+multiboot_info_t;
+
+/*! Module loaded with kernel */
+typedef struct _multiboot_module_t_
+{
+	uint32  mod_start;
+	uint32  mod_end;
+	uint32  string;
+	uint32  reserved;
+}
+multiboot_module_t;
+
+/*! Memory map entry ('size' doesn't include itself; 64 bit fields as
+ *  two 32 bit parts) */
+typedef struct _multiboot_mmap_t_
+{
+	uint32  size;
+	uint32  addr_low;
+	uint32  addr_high;
+	uint32  len_low;
+	uint32  len_high;
+	uint32  type;
+}
+__attribute__((packed)) multiboot_mmap_t;
+
+#endif /* ASM_FILE */
+
 /* Since other multiboot options aren't used they are not present here */
@@ -19,3 +19,8 @@
 
 /*! memory barrier */
 #define memory_barrier()	arch_memory_barrier()
+
+/*! atomic operations (return previous value) */
+#define atomic_cmpxchg(ptr, old, new)	arch_atomic_cmpxchg(ptr, old, new)
+#define atomic_xchg(ptr, value)		arch_atomic_xchg(ptr, value)
+#define atomic_add(ptr, value)		arch_atomic_add(ptr, value)
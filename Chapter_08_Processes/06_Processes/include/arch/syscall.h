@@ -22,4 +22,7 @@ static inline void *arch_syscall_get_params(context_t *cntx);
 /*! Save syscall return value for thread; gcc uses eax register */
 static inline void arch_syscall_set_retval(context_t *cntx, int retval);
 
+/*! Can threads use faster syscall entry (instead of software interrupt)? */
+static inline int arch_syscall_fast();
+
 #include <ARCH/syscall.h>
@@ -31,6 +31,12 @@ void arch_set_time(timespec_t *time);
 /*! Get minimal timer interval supported by hardware timer */
 void arch_get_min_interval(timespec_t *time);
 
+/*! Get number of timer interrupts since power on */
+uint arch_timer_interrupts();
+
+/*! Get TSC frequency in kHz (0 if not measured); is TSC used for time */
+uint arch_tsc_khz(int *used);
+
 /*! Enable/disable interrupt generated by hardware timer */
 void arch_enable_timer_interrupt();
 void arch_disable_timer_interrupt();
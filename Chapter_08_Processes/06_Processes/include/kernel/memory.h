@@ -3,6 +3,7 @@
 
 /*! interface to threads (via syscall) */
 int sys__sysinfo(void *p);
+int sys__sbrk(void *p);
 
 #ifdef _KERNEL_ /* (for kernel and arch layer) */
 
@@ -11,6 +12,18 @@ int sys__sysinfo(void *p);
 void *k_mem_init(void *segment, size_t size);
 void *kmalloc(size_t size);
 int kfree(void *chunk);
+int kextend(void *chunk, size_t size);
+void *kmalloc_below(size_t size, void *limit);
+void kmem_stat(size_t *free, size_t *largest);
+
+/*! object caches for frequently allocated fixed size objects */
+#include <lib/slab.h>
+typedef slab_cache_t kmem_cache_t;
+
+void kmem_cache_init(kmem_cache_t *cache, char *name, size_t size,
+		       void (*ctor)(void *obj));
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
 
 struct _kobject_t_; typedef struct _kobject_t_ kobject_t;
 struct _kprog_t_; typedef struct _kprog_t_ kprog_t;
@@ -18,6 +31,9 @@ struct _kprocess_t_; typedef struct _kprocess_t_ kprocess_t;
 
 void *k_process_start_adr(void *proc);
 size_t k_process_size(void *proc);
+#ifdef PAGING
+void *k_process_vm(void *proc);
+#endif
 
 void *k_u2k_adr(void *uadr, kprocess_t *proc);
 void *k_k2u_adr(void *kadr, kprocess_t *proc);
@@ -39,16 +39,10 @@ enum {
 	PTHREAD_MUTEX_DESTROY,
 	PTHREAD_MUTEX_LOCK,
 	PTHREAD_MUTEX_UNLOCK,
-	PTHREAD_COND_INIT,
-	PTHREAD_COND_DESTROY,
-	PTHREAD_COND_WAIT,
-	PTHREAD_COND_SIGNAL,
-	PTHREAD_COND_BROADCAST,
 
-	SEM_INIT,
-	SEM_DESTROY,
-	SEM_WAIT,
-	SEM_POST,
+	FUTEX_WAIT,
+	FUTEX_WAKE,
+	FUTEX_REQUEUE,
 
 	MQ_OPEN,
 	MQ_CLOSE,
@@ -61,6 +55,8 @@ enum {
 	SIGWAITINFO,
 
 	POSIX_SPAWN,
+	SBRK,
+	PRCTL,
 
 	SYSFUNCS
 };
@@ -17,8 +17,12 @@ typedef void ffs_mpool_t;
 
 /*! interface */
 void *ffs_init(void *mem_segm, size_t size);
+int ffs_add(ffs_mpool_t *mpool, void *mem_segm, size_t size);
 void *ffs_alloc(ffs_mpool_t *mpool, size_t size);
 int ffs_free(ffs_mpool_t *mpool, void *chunk_to_be_freed);
+int ffs_extend(ffs_mpool_t *mpool, void *chunk_to_extend, size_t size);
+void *ffs_alloc_below(ffs_mpool_t *mpool, size_t size, void *limit);
+void ffs_stat(ffs_mpool_t *mpool, size_t *free, size_t *largest);
 
 /*! rest is only for first_fit.c */
 #else /* _FF_SIMPLE_C_ */
@@ -75,8 +79,12 @@ ffs_mpool_t;
 	do {(P) = ALIGN_MASK & (((size_t)(P)) + (ALIGN_VAL - 1)) ; } while (0)
 
 void *ffs_init(void *mem_segm, size_t size);
+int ffs_add(ffs_mpool_t *mpool, void *mem_segm, size_t size);
 void *ffs_alloc(ffs_mpool_t *mpool, size_t size);
 int ffs_free(ffs_mpool_t *mpool, void *chunk_to_be_freed);
+int ffs_extend(ffs_mpool_t *mpool, void *chunk_to_extend, size_t size);
+void *ffs_alloc_below(ffs_mpool_t *mpool, size_t size, void *limit);
+void ffs_stat(ffs_mpool_t *mpool, size_t *free, size_t *largest);
 
 static void ffs_remove_chunk(ffs_mpool_t *mpool, ffs_hdr_t *chunk);
 static void ffs_insert_chunk(ffs_mpool_t *mpool, ffs_hdr_t *chunk);
@@ -177,6 +177,9 @@
 
 #include <types/basic.h>
 
+/*! gma_init flag: keep pool descriptor in given segment, not in static one */
+#define NEW_MPOOL	1
+
 /*! interface to kernel and other code (not for gma.c) */
 #ifndef _GMA_C_
 
@@ -355,8 +358,6 @@ do {(CHUNK)->prev = (mchunk_t *)(((size_t)(CHUNK)->prev) | 1); } while (0)
 #define SET_BORDER_CHUNK(CHUNK)	\
 do {(CHUNK)->size = BORDER_CHUNK; CLONE_CHUNK_SIZE(CHUNK); } while (0)
 
-#define NEW_MPOOL	1
-
 /*! mchunk list manipulations */
 #ifndef ASSERT
 #include ASSERT_H
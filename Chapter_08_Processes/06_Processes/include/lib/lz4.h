@@ -0,0 +1,16 @@
+/*! LZ4 decompression (block format)
+ *
+ * Compressed block is a sequence of: token, literals, match. Token's upper
+ * 4 bits are number of literals, lower 4 bits are match length - 4 (value 15
+ * is continued in following bytes, each adding up to 255). Literals are
+ * copied from input; match is copied from already decompressed output, from
+ * 2 byte (little endian) offset back. Last sequence has literals only.
+ * Blocks are created with tools/lzpack (program modules).
+ */
+
+#pragma once
+
+#include <types/basic.h>
+
+int lz4_decompress(const void *src, size_t src_size,
+		     void *dst, size_t dst_size);
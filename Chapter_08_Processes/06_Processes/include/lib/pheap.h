@@ -0,0 +1,56 @@
+/*!
+ * Pairing heap (priority queue)
+ *
+ * properties:
+ * - elements (objects) have pheap_h element included, as with lists (no
+ *   allocation); compare function is given at initialization
+ * - add: O(1); get first (smallest): O(1); remove first or any element:
+ *   O(log n) amortized
+ * - order of equal elements is not defined (compare function should use
+ *   tie-breaker if it matters)
+ */
+#pragma once
+
+#include <types/basic.h>
+
+/*! Heap element pointers */
+typedef struct _pheap_h_
+{
+	struct _pheap_h_  *child;
+			   /* first child (subheap with larger elements) */
+
+	struct _pheap_h_  *next;
+			   /* next sibling */
+
+	struct _pheap_h_  *prev;
+			   /* previous sibling or parent (for first child) */
+
+	void		  *object;
+			   /* pointer to object (which contains this pheap_h) */
+}
+pheap_h;
+
+/*! heap header type */
+typedef struct _pheap_
+{
+	pheap_h  *root;
+	int	(*cmp)(void *, void *);
+}
+pheap_t;
+
+void pheap_init(pheap_t *heap, int (*cmp)(void *, void *));
+
+/*! Add element to heap */
+void pheap_add(pheap_t *heap, void *object, pheap_h *hdr);
+
+/*! Get pointer to first (smallest) element, NULL if heap is empty */
+void *pheap_get_first(pheap_t *heap);
+
+/*! Remove and return first (smallest) element */
+void *pheap_remove_first(pheap_t *heap);
+
+/*!
+ * Remove given element from heap
+ * NOTE function assumes that element is in heap - it doesn't check!!!
+ */
+void *pheap_remove(pheap_t *heap, pheap_h *hdr);
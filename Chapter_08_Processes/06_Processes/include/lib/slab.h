@@ -0,0 +1,59 @@
+/*! Object cache (slab allocator) for fixed size objects
+ *
+ * Objects of one type are allocated from 'slabs': larger chunks taken from
+ * backing allocator, each divided into equal slots. Free slots are kept in
+ * single linked list, so allocation and release are O(1).
+ * List link is stored after object, so released object keeps its content:
+ * constructor (if given) is called only once per slot, when slab is added,
+ * and allocation returns object in state left by its previous user.
+ * Slabs are not returned to backing allocator (cache only grows).
+ */
+
+#pragma once
+
+#include <types/basic.h>
+
+/*! Object cache descriptor */
+typedef struct _slab_cache_t_
+{
+	char	*name;
+		 /* cache name (for statistics) */
+
+	size_t	 obj_size;
+		 /* object size, as requested */
+
+	size_t	 slot_size;
+		 /* object size with free list link, aligned */
+
+	uint	 slab_objs;
+		 /* objects per slab */
+
+	void	 (*ctor)(void *obj);
+		 /* object constructor (or NULL) */
+
+	void	*(*alloc)(size_t size);
+		 /* backing allocator for slabs */
+
+	void	*free;
+		 /* first free object */
+
+	uint	 slabs;
+		 /* number of allocated slabs */
+
+	uint	 in_use;
+		 /* number of allocated objects */
+
+	struct _slab_cache_t_ *next;
+		 /* next cache (for user managing more caches) */
+}
+slab_cache_t;
+
+/*! slab size (rounded to whole objects), and minimal objects in slab */
+#define SLAB_SIZE		1024
+#define SLAB_MIN_OBJS		4
+
+/*! interface */
+void slab_cache_init(slab_cache_t *cache, char *name, size_t obj_size,
+		       void (*ctor)(void *obj), void *(*alloc)(size_t size));
+void *slab_alloc(slab_cache_t *cache);
+void slab_free(slab_cache_t *cache, void *obj);
@@ -3,23 +3,55 @@
 
 #include <types/basic.h>
 
+#include <types/sched2.h>
+
 /*! POSIX thread descriptor (user space) */
 typedef descriptor_t pthread_t;
 typedef pthread_t pid_t;
 
+/*! Thread specific data */
+typedef int pthread_key_t;
+
+#define PTHREAD_KEYS_MAX		16
+#define PTHREAD_DESTRUCTOR_ITERATIONS	4
+
+/*! Thread local storage: on top of thread stack, for thread only (use only
+ *  from within thread, via arch_tls_get/set, or by kernel) */
+typedef struct _pthread_tls_t_
+{
+	void  *self;
+	       /* address of this block (in process address space) */
+
+	int    errno;
+	       /* exit status of last system function call */
+
+	void  *specific[PTHREAD_KEYS_MAX];
+	       /* values for thread specific data keys */
+
+	uint   specific_gen[PTHREAD_KEYS_MAX];
+	       /* key generation when value was set (stale after delete) */
+
+	void  *malloc_cache;
+	       /* thread cache of small free blocks (api/malloc.c) */
+}
+pthread_tls_t;
+
 /*! Scheduling parameters */
 typedef struct sched_param
 {
-	int  sched_priority;
-	     /* thread priority */
+	int           sched_priority;
+		      /* thread priority */
 
-	/* place here additional scheduling parameters for scheduler extension*/
+	sched_supp_t  supp;
+		      /* additional scheduling parameters for policy != FIFO */
 }
 sched_param_t;
 
 #define SCHED_FIFO		0
-#define SCHED_RR		1
-#define SCHED_NUM		2
+
+/*! prctl options (for calling thread) */
+#define PR_SET_TIMERSLACK	29	/* set timer slack (ns; 0 for default) */
+#define PR_GET_TIMERSLACK	30	/* get timer slack (ns) */
 
 #define THREAD_MIN_PRIO		0
 #define THREAD_MAX_PRIO		(PRIO_LEVELS - 1)
@@ -45,22 +77,81 @@ pthread_attr_t;
 #define	PTHREAD_SCOPE_SYSTEM		(1<<4)
 #define	PTHREAD_SCOPE_PROCESS		(1<<5)
 
-/*! Mutex */
-typedef descriptor_t pthread_mutex_t;
+/*!
+ * Mutex: uncontended lock/unlock use atomic operation on 'futex' word, kernel
+ * is entered only to block or wake thread (futex wait/wake); mutexes with
+ * priority inheritance or ceiling are kernel objects (every operation is
+ * system call)
+ */
+typedef struct _pthread_mutex_t_
+{
+	id_t   id;
+	void  *ptr;
+	       /* kernel object (PI/PP mutex), or NULL */
+
+	int    futex;
+	       /* 0 - unlocked, 1 - locked, 2 - locked, threads might wait */
+
+	void  *owner;
+	       /* thread that holds lock (its TLS address) */
+}
+pthread_mutex_t;
+
+#define PTHREAD_MUTEX_INITIALIZER	{ 0, NULL, 0, NULL }
 
 /*! Mutex creation parameters */
-typedef uint pthread_mutexattr_t;
+typedef struct _pthread_mutexattr_t_
+{
+	uint  flags;
+	      /* PTHREAD_PROCESS_SHARED/PRIVATE */
+
+	int   protocol;
+	      /* PTHREAD_PRIO_NONE/INHERIT/PROTECT */
+
+	int   prioceiling;
+	      /* priority ceiling (for PTHREAD_PRIO_PROTECT) */
+}
+pthread_mutexattr_t;
 #define	PTHREAD_PROCESS_SHARED		(1<<6)
 #define	PTHREAD_PROCESS_PRIVATE		(1<<7)
 
-/*! Condition variable */
-typedef descriptor_t pthread_cond_t;
+/* mutex protocols (priority inversion handling) */
+#define	PTHREAD_PRIO_NONE		0
+#define	PTHREAD_PRIO_INHERIT		1
+#define	PTHREAD_PRIO_PROTECT		2
+
+/*! Condition variable (futex based) */
+typedef struct _pthread_cond_t_
+{
+	int  seq;
+	     /* incremented on each signal/broadcast (futex word) */
+
+	int  waiters;
+	     /* number of waiting threads */
+
+	pthread_mutex_t *mutex;
+	     /* mutex used by waiters (for broadcast requeue) */
+}
+pthread_cond_t;
+
+#define PTHREAD_COND_INITIALIZER	{ 0, 0, NULL }
 
 /*! Condition variable creation parameters */
 typedef uint pthread_condattr_t;
 
-/*! Semaphore */
-typedef descriptor_t sem_t;
+/*! Semaphore (futex based) */
+typedef struct _sem_t_
+{
+	int   value;
+	      /* semaphore value (futex word) */
+
+	int   waiters;
+	      /* number of threads blocked on semaphore */
+
+	uint  flags;
+	      /* PTHREAD_PROCESS_SHARED */
+}
+sem_t;
 
 /*! Message queue */
 typedef descriptor_t mqd_t;
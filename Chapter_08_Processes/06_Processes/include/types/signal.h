@@ -3,6 +3,7 @@
 
 #include <types/basic.h>
 #include <types/pthread.h>
+#include <types/time.h>
 
 /* Signals for POSIX "compatibility" (not used as defined!) */
 #define SIGHUP		1	/* Hangup (POSIX) */
@@ -184,9 +185,18 @@ typedef struct sigevent
 	#define sigev_notify_function	_sigev_un._sigev_thread._function
 	#define sigev_notify_attributes	_sigev_un._sigev_thread._attribute
 	#define sigev_notify_thread_id	_sigev_un._tid;
+
+	timespec_t sigev_slack;		/* Timer slack (with SIGEV_SLACK) */
 }
 sigevent_t;
 
+/*
+ * Flag for 'sigev_notify' (timers only): timer may expire up to 'sigev_slack'
+ * later than set, so that it can be activated with other timers in the same
+ * timer interrupt
+ */
+#define SIGEV_SLACK	0x100
+
 /* signal notification type */
 enum {
 	SIGEV_NONE = 1,	/* No asynchronous notification is delivered when the
@@ -5,11 +5,13 @@
 
 #include <kernel/kprint.h>
 #include "thread.h"
+#include "time.h"
 #include <kernel/errno.h>
 #include <arch/processor.h>
 #include <arch/interrupt.h>
 #include <lib/string.h>
 #include <lib/list.h>
+#include <lib/lz4.h>
 #include <types/bits.h>
 
 /*! Dynamic memory allocator for kernel */
@@ -18,9 +20,33 @@ MEM_ALLOC_T *k_mpool = NULL;
 /*! Memory segments */
 static mseg_t *mseg = NULL;
 
+#ifndef PAGING
+/*! Kernel heap compaction statistics */
+static struct {
+	uint	runs;		/* compactions done */
+	uint	moved;		/* processes moved in all runs */
+	uint	frag_before;	/* fragmentation before and after last run */
+	uint	frag_after;
+} compaction;
+#endif
+
+/*! Object caches (list for statistics) */
+static kmem_cache_t *kcaches = NULL;
+static kmem_cache_t kobject_cache; /* kobject_t without embedded object */
+
+/*! Kernel allocations: from heap, object caches and ids (statistics) */
+static uint kallocs;
+
 /*! List of programs */
 list_t kprogs;
 
+/*! Compressed programs: unpacking statistics */
+static struct {
+	uint		count;	/* programs unpacked (processes started) */
+	size_t		bytes;	/* bytes unpacked */
+	timespec_t	time;	/* time spent unpacking */
+} unpacking;
+
 /*! Initial memory layout created in arch layer */
 void k_memory_init()
 {
@@ -30,47 +56,149 @@ void k_memory_init()
 	k_mpool = NULL;
 	mseg = arch_memory_init();
 
-	/* initialize dynamic memory allocation subsystem */
-	for (i = 0; mseg[i].type != MS_END && !k_mpool; i++)
+	/* initialize dynamic memory allocation subsystem; first heap segment
+	 * creates pool, others (non-contiguous memory regions) are added */
+	for (i = 0; mseg[i].type != MS_END; i++)
 	{
-		if (mseg[i].type == MS_KHEAP)
-		{
+		if (mseg[i].type != MS_KHEAP)
+			continue;
+
+		if (!k_mpool)
 			k_mpool = k_mem_init(mseg[i].start, mseg[i].size);
-			break;
-		}
+		else if (K_MEM_ADD(mseg[i].start, mseg[i].size))
+			LOG(WARN, "Memory region at %x not used!\n",
+			      mseg[i].start);
 	}
 
 	ASSERT(k_mpool);
 
+	kmem_cache_init(&kobject_cache, "kobject", sizeof(kobject_t), NULL);
+
 	list_init(&kprogs);
 
 	/* look into each segment marked as program and add it to 'progs' */
 	for (i = 0; mseg[i].type != MS_END; i++)
 	{
-		if (mseg[i].type != MS_PROGRAM)
+		if (mseg[i].type != MS_PROGRAM && mseg[i].type != MS_PROGRAM_LZ)
 			continue;
 
 		kprog = kmalloc(sizeof(kprog_t));
 
 		kprog->m = &mseg[i];
-		kprog->prog = & ((module_program_t *) mseg[i].start)->prog;
+		if (mseg[i].type == MS_PROGRAM)
+		{
+			kprog->packed = NULL;
+			kprog->prog = &((module_program_t *)
+					mseg[i].start)->prog;
+			kprog->size = mseg[i].size;
+		}
+		else {
+			/* program header is not compressed */
+			kprog->packed = mseg[i].start;
+			kprog->prog = (void *) (kprog->packed + 1);
+			kprog->size = kprog->packed->size;
+			ASSERT(kprog->packed->raw_size >=
+				sizeof(module_program_t));
+		}
 
+#ifdef STACK_PEAK
+		kprog->stack_peak = 0;
+		kprog->stack_threads = 0;
+#endif
 		list_append(&kprogs, kprog, &kprog->list);
 	}
 }
 
+/*!
+ * Copy program to process memory, unpack it if compressed
+ * \param kprog Program
+ * \param dst Process start address (space for kprog->size bytes)
+ * \return 0 if successful, -1 if compressed program is corrupted
+ */
+int k_program_load(kprog_t *kprog, void *dst)
+{
+	module_packed_t *packed = kprog->packed;
+	void *src;
+	timespec_t start, end;
+	int size;
+
+	if (!packed)
+	{
+		memcpy(dst, kprog->m->start, kprog->size);
+		return 0;
+	}
+
+	kclock_gettime(CLOCK_REALTIME, &start);
+
+	src = (void *) (packed + 1);
+	memcpy(dst, src, packed->raw_size);
+	size = lz4_decompress(src + packed->raw_size, packed->lz_size,
+				dst + packed->raw_size,
+				packed->size - packed->raw_size);
+
+	kclock_gettime(CLOCK_REALTIME, &end);
+	time_sub(&end, &start);
+	time_add(&unpacking.time, &end);
+	unpacking.count++;
+	unpacking.bytes += packed->size;
+
+	if (size != packed->size - packed->raw_size)
+	{
+		LOG(ERROR, "Program %s is corrupted!\n", kprog->prog->name);
+		return -1;
+	}
+
+	return 0;
+}
+
 void *k_mem_init(void *segment, size_t size)
 {
 	return K_MEM_INIT(segment, size);
 }
 void *kmalloc(size_t size)
 {
+	kallocs++;
 	return KMALLOC(size);
 }
 int kfree(void *chunk)
 {
 	return KFREE(chunk);
 }
+/*! grow chunk in place to 'size' bytes (0 if successful, -1 otherwise) */
+int kextend(void *chunk, size_t size)
+{
+	return KEXTEND(chunk, size);
+}
+/*! allocate at lowest address below 'limit' (NULL if not possible) */
+void *kmalloc_below(size_t size, void *limit)
+{
+	kallocs++;
+	return KMALLOC_BELOW(size, limit);
+}
+/*! free memory in kernel heap and its largest free chunk */
+void kmem_stat(size_t *free, size_t *largest)
+{
+	KMEM_STAT(free, largest);
+}
+
+/*! Object caches: slabs are allocated from kernel heap */
+void kmem_cache_init(kmem_cache_t *cache, char *name, size_t size,
+		       void (*ctor)(void *obj))
+{
+	slab_cache_init(cache, name, size, ctor, kmalloc);
+
+	cache->next = kcaches;
+	kcaches = cache;
+}
+void *kmem_cache_alloc(kmem_cache_t *cache)
+{
+	kallocs++;
+	return slab_alloc(cache);
+}
+void kmem_cache_free(kmem_cache_t *cache, void *obj)
+{
+	slab_free(cache, obj);
+}
 
 void *k_process_start_adr(void *proc)
 {
@@ -82,6 +210,13 @@ size_t k_process_size(void *proc)
 	return ((kprocess_t *) proc)->m.size;
 }
 
+#ifdef PAGING
+void *k_process_vm(void *proc)
+{
+	return ((kprocess_t *) proc)->vm;
+}
+#endif
+
 /*! kernel <--> user address translation (using segmentation) */
 void *k_u2k_adr(void *uadr, kprocess_t *proc)
 {
@@ -104,7 +239,10 @@ void *kmalloc_kobject(kprocess_t *proc, size_t obj_size)
 
 	ASSERT(proc);
 
-	kobj = kmalloc(sizeof(kobject_t) + obj_size);
+	if (obj_size)
+		kobj = kmalloc(sizeof(kobject_t) + obj_size);
+	else
+		kobj = kmem_cache_alloc(&kobject_cache);
 	ASSERT(kobj);
 
 	kobj->flags = 0;
@@ -120,6 +258,15 @@ void *kmalloc_kobject(kprocess_t *proc, size_t obj_size)
 	return kobj;
 }
 
+/* kobject with embedded object is from heap, without from kobject cache */
+static void kobject_free(kobject_t *kobj)
+{
+	if (kobj->kobject == kobj + 1)
+		kfree(kobj);
+	else
+		kmem_cache_free(&kobject_cache, kobj);
+}
+
 /*! Free space reserved by kernel object */
 void *kfree_kobject(kprocess_t *proc, kobject_t *kobj)
 {
@@ -131,7 +278,7 @@ void *kfree_kobject(kprocess_t *proc, kobject_t *kobj)
 	ASSERT(list_find_and_remove(&proc->kobjects, &kobj->list));
 #endif
 
-	kfree(kobj);
+	kobject_free(kobj);
 
 	return EXIT_SUCCESS;
 }
@@ -144,7 +291,7 @@ int kfree_process_kobjects(kprocess_t *proc)
 	kobject_t *kobj;
 
 	while ((kobj = list_remove(&proc->kobjects, 0, NULL)) != NULL)
-		kfree(kobj);
+		kobject_free(kobj);
 
 	return EXIT_SUCCESS;
 }
@@ -165,6 +312,7 @@ id_t k_new_id()
 	uint elem, n, start;
 	word_t mask;
 
+	kallocs++;
 	last_id++;
 	if (last_id == MAX_RES)
 		last_id = 1; /* skip 0 */
@@ -263,6 +411,79 @@ void kprocess_stack_free(kprocess_t *kproc, void *stack)
 }
 
 
+/*! Kernel heap fragmentation: part of free memory not in largest chunk (%) */
+static uint kmem_fragmentation()
+{
+	size_t free, largest, pct;
+
+	kmem_stat(&free, &largest);
+	if (free < 100)
+		return 0;
+
+	pct = largest / (free / 100);
+
+	return pct < 100 ? 100 - pct : 0;
+}
+
+#ifndef PAGING
+/*!
+ * Compact kernel heap: move process images down, so free chunks between them
+ * join (when large allocation fails). Process addresses are segment relative,
+ * so process can be moved with memcpy and new segment start.
+ * \return number of moved processes
+ */
+int kmem_compact()
+{
+	int moved;
+
+	compaction.frag_before = kmem_fragmentation();
+	moved = kprocess_compact();
+	compaction.frag_after = kmem_fragmentation();
+
+	compaction.runs++;
+	compaction.moved += moved;
+
+	return moved;
+}
+#endif
+
+/*!
+ * Change process heap size; heap is at the end of process, so process memory
+ * is resized (and maybe moved)
+ * \param increment Number of bytes to add to heap (remove if negative)
+ * \return previous heap end (process address), -1 if not enough memory
+ */
+int sys__sbrk(void *p)
+{
+	int increment;
+	kprocess_t *kproc;
+	size_t old_size, heap_start;
+
+	increment = *((int *) p);
+
+	kproc = kthread_get_process(NULL);
+	old_size = kproc->m.size;
+	heap_start = kproc->heap - kproc->m.start;
+
+	if (increment < 0 && old_size - heap_start < (size_t) -increment)
+		EXIT2(EINVAL, EXIT_FAILURE);
+
+	if (increment > 0 && old_size + increment < old_size)
+		EXIT2(ENOMEM, EXIT_FAILURE);
+
+	if (increment && kprocess_resize(kproc, old_size + increment))
+		EXIT2(ENOMEM, EXIT_FAILURE);
+
+	kproc->heap_size += increment;
+
+	SET_ERRNO(EXIT_SUCCESS);
+
+	/* reload process segment descriptors (new size and maybe start) */
+	kthreads_schedule();
+
+	return old_size;
+}
+
 
 /*!
  * Give list of all programs
@@ -303,6 +524,7 @@ int k_list_programs(char *buffer, size_t buf_size)
 void k_memory_info()
 {
 	int i;
+	kmem_cache_t *cache;
 
 	kprintf("Memory segments\n"
 		 "===============\n"
@@ -314,8 +536,82 @@ void k_memory_info()
 		kprintf("%d\t%x\t%x\n", mseg[i].type, mseg[i].size,
 					  mseg[i].start);
 	}
+
+	{
+		size_t free, largest;
+
+		kmem_stat(&free, &largest);
+		if (free)
+			kprintf("\nKernel heap: %d bytes free, largest free "
+				 "chunk %d, fragmentation %d percent\n", free,
+				 largest, kmem_fragmentation());
+		kprintf("Kernel allocations (heap, object caches, ids): %d\n",
+			 kallocs);
+	}
+#ifndef PAGING
+	if (compaction.runs)
+		kprintf("Compaction: %d runs, %d processes moved, last run "
+			 "fragmentation %d -> %d percent\n", compaction.runs,
+			 compaction.moved, compaction.frag_before,
+			 compaction.frag_after);
+#endif
+
+	{
+		kprog_t *kprog;
+		size_t resident = 0, unpacked = 0;
+		uint usec;
+
+		for (kprog = list_get(&kprogs, FIRST); kprog;
+		     kprog = list_get_next(&kprog->list))
+		{
+			resident += kprog->m->size;
+			unpacked += kprog->size;
+		}
+		kprintf("\nProgram modules: %d bytes (%d when unpacked)\n",
+			 resident, unpacked);
+
+		if (unpacking.count)
+		{
+			usec = unpacking.time.tv_sec * 1000000 +
+				unpacking.time.tv_nsec / 1000;
+			kprintf("Unpacked %d times, %d bytes, %d us (%d us per "
+				 "start)\n", unpacking.count, unpacking.bytes,
+				 usec, usec / unpacking.count);
+		}
+	}
+
+#ifdef PAGING
+	{
+		uint used, total;
+
+		arch_vm_pool_info(&used, &total);
+		kprintf("\nPage pool: %d of %d pages used\n", used, total);
+	}
+#endif
+
+	kprintf("\nObject caches\n"
+		 "=============\n"
+		 "Name\t\tsize\tin use\ttotal\tslabs\n"
+	);
+
+	for (cache = kcaches; cache; cache = cache->next)
+	{
+		kprintf("%s\t%s%d\t%d\t%d\t%d\n", cache->name,
+			 strlen(cache->name) < 8 ? "\t" : "", cache->obj_size,
+			 cache->in_use, cache->slabs * cache->slab_objs,
+			 cache->slabs);
+	}
 }
 
+#ifdef PAGING
+/*! Page fault in thread: map heap/stack page on first touch */
+void k_page_fault()
+{
+	if (arch_vm_fault())
+		k_memory_fault();
+}
+#endif
+
 /*! Handle memory fault interrupt(and others undefined) */
 void k_memory_fault()
 {
@@ -340,7 +636,7 @@ int sys__sysinfo(void *p)
 	size_t buf_size;
 	char **param; /* last param is NULL */
 	char *param1; /* *param0; */
-	char usage[] = "Usage: sysinfo [programs|threads|memory]";
+	char usage[] = "Usage: sysinfo [programs|threads|memory|pages|allocs]";
 	char look_console[] = " (sysinfo printed on console)";
 
 	buffer = *((char **) p); p += sizeof(char *);
@@ -385,6 +681,23 @@ int sys__sysinfo(void *p)
 			EXIT(EXIT_SUCCESS);
 			/* TODO: "memory [segments|modules|***]" */
 		}
+		else if (strcmp("pages", param1) == 0)
+		{
+			/* used pages from page pool, as return value */
+#ifdef PAGING
+			uint used, total;
+
+			arch_vm_pool_info(&used, &total);
+			EXIT2(EXIT_SUCCESS, used);
+#else
+			EXIT2(ENOTSUP, -1);
+#endif
+		}
+		else if (strcmp("allocs", param1) == 0)
+		{
+			/* kernel allocations since boot, as return value */
+			EXIT2(EXIT_SUCCESS, kallocs);
+		}
 		else if (strcmp("threads", param1) == 0)
 		{
 			kthread_info();
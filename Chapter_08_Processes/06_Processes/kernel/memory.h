@@ -11,15 +11,24 @@
 
 #define MEM_ALLOC_T ffs_mpool_t
 #define	K_MEM_INIT(segment, size)	ffs_init(segment, size)
+#define	K_MEM_ADD(segment, size)		ffs_add(k_mpool, segment, size)
 #define	KMALLOC(size)			ffs_alloc(k_mpool, size)
 #define	KFREE(addr)			ffs_free(k_mpool, addr)
+#define	KEXTEND(addr, size)		ffs_extend(k_mpool, addr, size)
+#define	KMALLOC_BELOW(size, limit)	ffs_alloc_below(k_mpool, size, limit)
+#define	KMEM_STAT(free, largest)	ffs_stat(k_mpool, free, largest)
 
 #elif MEM_ALLOCATOR_FOR_KERNEL == GMA
 
 #define MEM_ALLOC_T gma_t
 #define	K_MEM_INIT(segment, size)	gma_init(segment, size, 32, 0)
+#define	K_MEM_ADD(segment, size)		(-1) /* not supported */
 #define	KMALLOC(size)			gma_alloc(k_mpool, size)
 #define	KFREE(addr)			gma_free(k_mpool, addr)
+#define	KEXTEND(addr, size)		(-1) /* not supported: chunk is moved */
+#define	KMALLOC_BELOW(size, limit)	NULL /* not supported */
+#define	KMEM_STAT(free, largest)	\
+	do { *(free) = *(largest) = 0; } while (0) /* not supported */
 
 #else /* memory allocator not selected! */
 
@@ -38,6 +47,10 @@ extern MEM_ALLOC_T *k_mpool; /* defined in *ff_simple.c, *gma.h, ... */
 
 void k_memory_init();
 void k_memory_info();
+int k_program_load(kprog_t *kprog, void *dst);
+#ifndef PAGING
+int kmem_compact();
+#endif
 
 
 /*! Available (loaded) programs */
@@ -49,6 +62,19 @@ struct _kprog_t_
 	mseg_t     *m;
 		    /* memory segment this program occupies */
 
+	size_t      size;
+		    /* program size in process (unpacked) */
+
+	module_packed_t *packed;
+		    /* compressed program (NULL if not) */
+
+#ifdef STACK_PEAK
+	size_t      stack_peak;
+		    /* largest thread stack usage in all its processes */
+	uint        stack_threads;
+		    /* number of finished threads (included in peak) */
+#endif
+
 	list_h      list;
 };
 
@@ -59,11 +85,18 @@ struct _kprocess_t_
 {
 	mseg_t	      m;
 		      /* memory segment this process occupies */
+#ifdef PAGING
+	void	     *vm;
+		      /* its address space (m.start is linear address) */
+#endif
 
 	process_t    *proc;
 		      /* process header - at start of process memory */
 
 	char          name[16];	/* program name */
+#ifdef STACK_PEAK
+	kprog_t      *kprog;	/* program (NULL for kernel) */
+#endif
 
 	void         *heap; /* physical address of heap area */
 	size_t        heap_size;
@@ -112,6 +145,9 @@ int k_check_id(id_t id);
 int k_list_programs(char *buffer, size_t buf_size);
 
 void k_memory_fault(); /* memory fault handler */
+#ifdef PAGING
+void k_page_fault();
+#endif
 
 void *kmalloc_kobject(kprocess_t *proc, size_t obj_size);
 void *kfree_kobject(kprocess_t *proc, kobject_t *kobj);
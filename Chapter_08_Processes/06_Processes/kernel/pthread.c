@@ -14,6 +14,27 @@
 #include <lib/string.h>
 #include <kernel/errno.h>
 
+/*! futex wait queues (hashed by kernel address of futex word) */
+#define FUTEX_HASH_SIZE		32	/* must be power of 2 */
+#define FUTEX_HASH(UADDR)	(((aint) (UADDR) >> 2) & (FUTEX_HASH_SIZE - 1))
+
+static kthread_q futex_queue[FUTEX_HASH_SIZE];
+
+/*! cache for messages up to KMQ_SMALL_MSG bytes (larger are from heap) */
+static kmem_cache_t kmq_msg_cache;
+
+/*! Initialize synchronization and communication subsystem */
+void kpthread_init()
+{
+	int i;
+
+	for (i = 0; i < FUTEX_HASH_SIZE; i++)
+		kthreadq_init(&futex_queue[i]);
+
+	kmem_cache_init(&kmq_msg_cache, "kmq_msg",
+			  sizeof(kmq_msg_t) + KMQ_SMALL_MSG, NULL);
+}
+
 /*! Threads ----------------------------------------------------------------- */
 
 /*!
@@ -35,6 +56,7 @@ int sys__pthread_create(void *p)
 	uint flags = 0;
 	int sched_policy = SCHED_FIFO;
 	int sched_priority = THREAD_DEF_PRIO;
+	sched_supp_t *sched_supp = NULL;
 	void *stackaddr = NULL;
 	size_t stacksize = 0;
 
@@ -51,6 +73,7 @@ int sys__pthread_create(void *p)
 			flags = attr->flags;
 			sched_policy = attr->sched_policy;
 			sched_priority = attr->sched_params.sched_priority;
+			sched_supp = &attr->sched_params.supp;
 			stackaddr = attr->stackaddr;
 			stacksize = attr->stacksize;
 
@@ -69,7 +92,7 @@ int sys__pthread_create(void *p)
 	}
 
 	kthread = kthread_create(start_routine, arg, flags,
-				   sched_policy, sched_priority,
+				   sched_policy, sched_priority, sched_supp,
 				   stackaddr, stacksize,
 				   kthread_get_process(NULL)
  				);
@@ -215,6 +238,40 @@ int sys__pthread_setschedparam(void *p)
 	return kthread_setschedparam(kthread, policy, param);
 }
 
+/*!
+ * Set/get calling thread properties
+ * \param option PR_SET_TIMERSLACK or PR_GET_TIMERSLACK
+ * \param arg Timer slack in ns (for PR_SET_TIMERSLACK; 0 for default)
+ * \return timer slack for PR_GET_TIMERSLACK, 0 for PR_SET_TIMERSLACK
+ */
+int sys__prctl(void *p)
+{
+	int option;
+	long arg;
+
+	timespec_t slack;
+
+	option = *((int *) p);		p += sizeof(int);
+	arg =	 *((long *) p);
+
+	switch (option)
+	{
+	case PR_SET_TIMERSLACK:
+		ASSERT_ERRNO_AND_EXIT(arg >= 0, EINVAL);
+		slack.tv_sec = arg / 1000000000L;
+		slack.tv_nsec = arg % 1000000000L;
+		kthread_set_timer_slack(NULL, arg ? &slack : NULL);
+		EXIT(EXIT_SUCCESS);
+
+	case PR_GET_TIMERSLACK:
+		kthread_get_timer_slack(NULL, &slack);
+		EXIT2(EXIT_SUCCESS, slack.tv_sec * 1000000000L + slack.tv_nsec);
+
+	default:
+		EXIT(EINVAL);
+	}
+}
+
 /*!
  * Start new process
  * \param pid PID of created process
@@ -330,14 +387,14 @@ int sys__get_errno_ptr(void *p)
 int sys__pthread_mutex_init(void *p)
 {
 	pthread_mutex_t *mutex;
-	/* pthread_mutexattr_t *mutexattr; not implemented */
+	pthread_mutexattr_t *mutexattr;
 
 	kprocess_t *proc;
 	kpthread_mutex_t *kmutex;
 	kobject_t *kobj;
 
-	mutex = *((pthread_mutex_t **) p); /* p += sizeof(pthread_mutex_t *);
-	mutexattr = *((pthread_mutexattr_t *) p); */
+	mutex = *((pthread_mutex_t **) p);	p += sizeof(pthread_mutex_t *);
+	mutexattr = *((pthread_mutexattr_t **) p);
 
 	ASSERT_ERRNO_AND_EXIT(mutex, EINVAL);
 
@@ -345,6 +402,20 @@ int sys__pthread_mutex_init(void *p)
 	mutex = U2K_GET_ADR(mutex, proc);
 	ASSERT_ERRNO_AND_EXIT(mutex, EINVAL);
 
+	if (mutexattr)
+	{
+		mutexattr = U2K_GET_ADR(mutexattr, proc);
+		ASSERT_ERRNO_AND_EXIT(mutexattr, EINVAL);
+		ASSERT_ERRNO_AND_EXIT(
+			mutexattr->protocol == PTHREAD_PRIO_NONE ||
+			mutexattr->protocol == PTHREAD_PRIO_INHERIT ||
+			mutexattr->protocol == PTHREAD_PRIO_PROTECT, ENOTSUP);
+		ASSERT_ERRNO_AND_EXIT(
+			mutexattr->protocol != PTHREAD_PRIO_PROTECT ||
+			(mutexattr->prioceiling >= THREAD_MIN_PRIO &&
+			 mutexattr->prioceiling <= THREAD_MAX_PRIO), EINVAL);
+	}
+
 	kobj = kmalloc_kobject(proc, sizeof(kpthread_mutex_t));
 	ASSERT_ERRNO_AND_EXIT(kobj, ENOMEM);
 	kmutex = kobj->kobject;
@@ -355,6 +426,16 @@ int sys__pthread_mutex_init(void *p)
 	kmutex->ref_cnt = 1;
 	kthreadq_init(&kmutex->queue);
 
+	if (mutexattr)
+	{
+		kmutex->protocol = mutexattr->protocol;
+		kmutex->prioceiling = mutexattr->prioceiling;
+	}
+	else {
+		kmutex->protocol = PTHREAD_PRIO_NONE;
+		kmutex->prioceiling = THREAD_MAX_PRIO;
+	}
+
 	mutex->ptr = kobj;
 	mutex->id = kmutex->id;
 
@@ -410,6 +491,7 @@ int sys__pthread_mutex_destroy(void *p)
 }
 
 static int mutex_lock(kpthread_mutex_t *kmutex, kthread_t *kthread);
+static int mutex_unlock(kpthread_mutex_t *kmutex);
 
 /*!
  * Lock mutex object
@@ -452,10 +534,27 @@ static int mutex_lock(kpthread_mutex_t *kmutex, kthread_t *kthread)
 {
 	if (!kmutex->owner)
 	{
+		if (kmutex->protocol == PTHREAD_PRIO_PROTECT &&
+			kthread_get_prio(kthread) > kmutex->prioceiling)
+		{
+			kthread_set_errno(kthread, EINVAL);
+			return -1;
+		}
+
 		/* mutex was not locked, acquire lock on it */
 		kmutex->owner = kthread;
 		kthread_set_errno(kthread, EXIT_SUCCESS);
 
+		if (kmutex->protocol != PTHREAD_PRIO_NONE)
+		{
+			list_append(kthread_get_mutexes(kthread), kmutex,
+				      &kmutex->list);
+
+			/* ceiling is applied immediately */
+			if (kmutex->protocol == PTHREAD_PRIO_PROTECT)
+				kpthread_mutex_prio_update(kthread);
+		}
+
 		return 0;
 	}
 	else {
@@ -471,459 +570,371 @@ static int mutex_lock(kpthread_mutex_t *kmutex, kthread_t *kthread)
 		kthread_set_errno(kthread, EXIT_SUCCESS);
 		kthread_enqueue(kthread, &kmutex->queue, 0, NULL, NULL);
 
+		/* owner (and owners it waits on) inherits waiter priority */
+		if (kmutex->protocol == PTHREAD_PRIO_INHERIT)
+		{
+			kthread_set_mutex_wait(kthread, kmutex);
+			kpthread_mutex_prio_update(kmutex->owner);
+		}
+
 		return 1;
 	}
 }
 
 /*!
- * Unlock mutex object
- * \param mutex Mutex descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+ * release mutex (owned by active thread) and pass it to next waiting thread;
+ * return 1 if rescheduling is required, 0 otherwise
  */
-int sys__pthread_mutex_unlock(void *p)
+static int mutex_unlock(kpthread_mutex_t *kmutex)
 {
-	pthread_mutex_t *mutex;
-
-	kprocess_t *proc;
-	kpthread_mutex_t *kmutex;
-	kobject_t *kobj;
+	kthread_t *owner, *next, *iter;
 
-	mutex = *((pthread_mutex_t **) p);
-	ASSERT_ERRNO_AND_EXIT(mutex, EINVAL);
-
-	proc = kthread_get_process(NULL);
-	mutex = U2K_GET_ADR(mutex, proc);
-	ASSERT_ERRNO_AND_EXIT(mutex, EINVAL);
-
-	kobj = mutex->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj->list),
-				EINVAL);
-	kmutex = kobj->kobject;
-	ASSERT_ERRNO_AND_EXIT(kmutex && kmutex->id == mutex->id, EINVAL);
-
-	if (kmutex->owner != kthread_get_active())
+	if (kmutex->protocol == PTHREAD_PRIO_NONE)
 	{
-		SET_ERRNO(EPERM);
-		return EXIT_FAILURE;
+		kmutex->owner = kthreadq_get(&kmutex->queue);
+		if (kmutex->owner)
+		{
+			kthreadq_release(&kmutex->queue);
+			return 1;
+		}
+		return 0;
 	}
 
-	SET_ERRNO(EXIT_SUCCESS);
-
-	kmutex->owner = kthreadq_get(&kmutex->queue);
-	if (kmutex->owner)
+	/* PI/PP mutex: pass it to highest priority waiting thread */
+	owner = kmutex->owner;
+	next = iter = kthreadq_get(&kmutex->queue);
+	while (iter)
 	{
-		kthreadq_release(&kmutex->queue);
-		kthreads_schedule();
+		if (kthread_get_prio(iter) > kthread_get_prio(next))
+			next = iter;
+		iter = kthreadq_get_next(iter);
 	}
 
-	return EXIT_SUCCESS;
-}
-
-/*! conditional variables --------------------------------------------------- */
-
-/*!
- * Initialize conditional variable object
- * \param cond conditional variable descriptor (user level descriptor)
- * \param condattr conditional variable descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
- */
-int sys__pthread_cond_init(void *p)
-{
-	pthread_cond_t *cond;
-	/* pthread_condattr_t *condattr; not implemented */
-
-	kprocess_t *proc;
-	kpthread_cond_t *kcond;
-	kobject_t *kobj;
-
-	cond = *((pthread_cond_t **) p); /* p += sizeof(pthread_cond_t *);
-	condattr = *((pthread_condattr_t *) p); */
-
-	ASSERT_ERRNO_AND_EXIT(cond, EINVAL);
+	(void) list_remove(kthread_get_mutexes(owner), 0, &kmutex->list);
+	kmutex->owner = next;
 
-	proc = kthread_get_process(NULL);
-	cond = U2K_GET_ADR(cond, proc);
-	ASSERT_ERRNO_AND_EXIT(cond, EINVAL);
+	if (next)
+	{
+		/* put selected thread first, then release it */
+		(void) kthreadq_remove(&kmutex->queue, next);
+		kthreadq_prepend(&kmutex->queue, next);
+		kthreadq_release(&kmutex->queue);
 
-	kobj = kmalloc_kobject(proc, sizeof(kpthread_cond_t));
-	ASSERT_ERRNO_AND_EXIT(kobj, ENOMEM);
-	kcond = kobj->kobject;
+		kthread_set_mutex_wait(next, NULL);
+		list_append(kthread_get_mutexes(next), kmutex, &kmutex->list);
 
-	kcond->id = k_new_id();
-	kcond->flags = 0;
-	kcond->ref_cnt = 1;
-	kthreadq_init(&kcond->queue);
+		/* remaining waiters (or ceiling) are inherited by new owner */
+		kpthread_mutex_prio_update(next);
+	}
 
-	cond->ptr = kobj;
-	cond->id = kcond->id;
+	/* drop boost given by this mutex */
+	kpthread_mutex_prio_update(owner);
 
-	EXIT2(EXIT_SUCCESS, EXIT_SUCCESS);
+	return 1;
 }
 
-/*!
- * Destroy conditional variable object
- * \param cond conditional variable descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
- */
-int sys__pthread_cond_destroy(void *p)
+/*! highest priority of threads waiting on mutex (-1 if none) */
+static int mutex_waiters_prio(kpthread_mutex_t *kmutex)
 {
-	pthread_cond_t *cond;
-
-	kprocess_t *proc;
-	kpthread_cond_t *kcond;
-	kobject_t *kobj;
-
-	cond = *((pthread_cond_t **) p);
-	ASSERT_ERRNO_AND_EXIT(cond, EINVAL);
-
-	proc = kthread_get_process(NULL);
-	cond = U2K_GET_ADR(cond, proc);
-	ASSERT_ERRNO_AND_EXIT(cond, EINVAL);
-
-	kobj = cond->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj->list),
-				EINVAL);
-	kcond = kobj->kobject;
-	ASSERT_ERRNO_AND_EXIT(kcond && kcond->id == cond->id, EINVAL);
-
-	kcond->ref_cnt--;
-
-	/* additional cleanup here (e.g. if cond.var. is shared leave it) */
-	if (kcond->ref_cnt)
-		EXIT2(EBUSY, EXIT_FAILURE);
-
-	kfree_kobject(proc, kobj);
+	kthread_t *kthread;
+	int prio = -1;
 
-	cond->ptr = NULL;
-	cond->id = 0;
+	kthread = kthreadq_get(&kmutex->queue);
+	while (kthread)
+	{
+		if (kthread_get_prio(kthread) > prio)
+			prio = kthread_get_prio(kthread);
+		kthread = kthreadq_get_next(kthread);
+	}
 
-	EXIT2(EXIT_SUCCESS, EXIT_SUCCESS);
+	return prio;
 }
 
 /*!
- * Wait on conditional variable
- * \param cond conditional variable descriptor (user level descriptor)
- * \param mutex Mutex descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+ * Recalculate thread priority: base priority raised by held mutexes (ceiling
+ * for PTHREAD_PRIO_PROTECT, highest waiter for PTHREAD_PRIO_INHERIT); if it
+ * changes and thread is blocked on PI mutex, repeat for that mutex owner
+ * (boost propagates along chain of owners)
  */
-int sys__pthread_cond_wait(void *p)
+void kpthread_mutex_prio_update(kthread_t *kthread)
 {
-	pthread_cond_t *cond;
-	pthread_mutex_t *mutex;
-
-	kprocess_t *proc;
-	kpthread_cond_t *kcond;
 	kpthread_mutex_t *kmutex;
-	kobject_t *kobj_cond, *kobj_mutex;
-	int retval = EXIT_SUCCESS;
-
-	cond = *((pthread_cond_t **) p); p += sizeof(pthread_cond_t *);
-	mutex = *((pthread_mutex_t **) p);
-	ASSERT_ERRNO_AND_EXIT(cond && mutex, EINVAL);
-
-	proc = kthread_get_process(NULL);
-	cond = U2K_GET_ADR(cond, proc);
-	mutex = U2K_GET_ADR(mutex, proc);
-	ASSERT_ERRNO_AND_EXIT(cond && mutex, EINVAL);
-
-	kobj_cond = cond->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj_cond, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj_cond->list),
-				EINVAL);
-	kcond = kobj_cond->kobject;
-	ASSERT_ERRNO_AND_EXIT(kcond && kcond->id == cond->id, EINVAL);
+	int prio, mprio;
 
-	kobj_mutex = mutex->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj_mutex, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj_mutex->list),
-				EINVAL);
-	kmutex = kobj_mutex->kobject;
-	ASSERT_ERRNO_AND_EXIT(kmutex && kmutex->id == mutex->id, EINVAL);
-
-	ASSERT_ERRNO_AND_EXIT(kmutex->owner == kthread_get_active(), EPERM);
+	while (kthread)
+	{
+		prio = kthread_get_base_prio(kthread);
 
-	SET_ERRNO(EXIT_SUCCESS);
+		kmutex = list_get(kthread_get_mutexes(kthread), FIRST);
+		while (kmutex)
+		{
+			if (kmutex->protocol == PTHREAD_PRIO_PROTECT)
+				mprio = kmutex->prioceiling;
+			else
+				mprio = mutex_waiters_prio(kmutex);
 
-	/* move thread in conditional variable queue */
-	kthread_enqueue(NULL, &kcond->queue, 0, NULL, NULL);
+			if (mprio > prio)
+				prio = mprio;
 
-	/* save reference to mutex object */
-	kthread_set_private_param(NULL, kobj_mutex);
+			kmutex = list_get_next(&kmutex->list);
+		}
 
-	/* release mutex */
-	kmutex->owner = kthreadq_get(&kmutex->queue);
-	if (kmutex->owner)
-		kthreadq_release(&kmutex->queue);
+		if (prio == kthread_get_prio(kthread))
+			break; /* no change - nothing to propagate */
 
-	kthreads_schedule();
+		kthread_set_prio(kthread, prio);
 
-	return retval;
+		kmutex = kthread_get_mutex_wait(kthread);
+		kthread = kmutex ? kmutex->owner : NULL;
+	}
 }
 
-static int cond_release(void *p, int release_all);
-
 /*!
- * Restart thread waiting on conditional variable
- * \param cond conditional variable descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+ * Thread left mutex queue without getting the lock (canceled or interrupted
+ * while blocked): mutex owner loses priority it inherited from this thread
  */
-int sys__pthread_cond_signal(void *p)
+void kpthread_mutex_wait_abort(kthread_t *kthread)
 {
-	return cond_release(p, FALSE);
+	kpthread_mutex_t *kmutex = kthread_get_mutex_wait(kthread);
+
+	if (kmutex)
+	{
+		kthread_set_mutex_wait(kthread, NULL);
+		kpthread_mutex_prio_update(kmutex->owner);
+	}
 }
 
 /*!
- * Restart all threads waiting on conditional variable
- * \param cond conditional variable descriptor (user level descriptor)
+ * Unlock mutex object
+ * \param mutex Mutex descriptor (user level descriptor)
  * \return 0 if successful, -1 otherwise and appropriate error number is set
  */
-int sys__pthread_cond_broadcast(void *p)
-{
-	return cond_release(p, TRUE);
-}
-
-static int cond_release(void *p, int release_all)
+int sys__pthread_mutex_unlock(void *p)
 {
-	pthread_cond_t *cond;
+	pthread_mutex_t *mutex;
 
 	kprocess_t *proc;
-	kpthread_cond_t *kcond;
 	kpthread_mutex_t *kmutex;
-	kobject_t *kobj_cond, *kobj_mutex;
-	kthread_t *kthread;
-	int released = 0;
+	kobject_t *kobj;
 
-	cond = *((pthread_cond_t **) p);
-	ASSERT_ERRNO_AND_EXIT(cond, EINVAL);
+	mutex = *((pthread_mutex_t **) p);
+	ASSERT_ERRNO_AND_EXIT(mutex, EINVAL);
 
 	proc = kthread_get_process(NULL);
-	cond = U2K_GET_ADR(cond, proc);
-	ASSERT_ERRNO_AND_EXIT(cond, EINVAL);
+	mutex = U2K_GET_ADR(mutex, proc);
+	ASSERT_ERRNO_AND_EXIT(mutex, EINVAL);
 
-	kobj_cond = cond->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj_cond, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj_cond->list),
+	kobj = mutex->ptr;
+	ASSERT_ERRNO_AND_EXIT(kobj, EINVAL);
+	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj->list),
 				EINVAL);
-	kcond = kobj_cond->kobject;
-	ASSERT_ERRNO_AND_EXIT(kcond && kcond->id == cond->id, EINVAL);
-
-	kthread_set_errno(kthread_get_active(), EXIT_SUCCESS);
+	kmutex = kobj->kobject;
+	ASSERT_ERRNO_AND_EXIT(kmutex && kmutex->id == mutex->id, EINVAL);
 
-	while ((kthread = kthreadq_remove(&kcond->queue, NULL)))
+	if (kmutex->owner != kthread_get_active())
 	{
-		kobj_mutex = kthread_get_private_param(kthread);
-		kmutex = kobj_mutex->kobject;
-
-		if (mutex_lock(kmutex, kthread) == 0) {
-			kthread_move_to_ready(kthread, LAST);
-			released++;
-		}
-
-		/* release only one? */
-		if (!release_all)
-			break;
+		SET_ERRNO(EPERM);
+		return EXIT_FAILURE;
 	}
 
-	if (released)
+	SET_ERRNO(EXIT_SUCCESS);
+
+	if (mutex_unlock(kmutex))
 		kthreads_schedule();
 
 	return EXIT_SUCCESS;
 }
 
+/*! Futex ----------------------------------------------------------------- */
 
-/*! Semaphore --------------------------------------------------------------- */
-
-/*!
- * Initialize semaphore object
- * \param sem Semaphore descriptor (user level descriptor)
- * \param pshared Shall semaphore object be shared between processes
- * \param value Initial semaphore value
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+/*
+ * Wait queues keyed by address of integer in process address space ('futex'
+ * word); user space mutexes, semaphores and conditional variables use atomic
+ * operations on futex word and enter kernel only to block or to wake threads.
+ * Threads blocked on futexes are in hashed queues (by process address of
+ * futex word, which doesn't change when process is moved) with kernel address
+ * of futex word saved as private parameter.
  */
-int sys__sem_init(void *p)
-{
-	sem_t *sem;
-	int pshared;
-	int value;
 
-	kprocess_t *proc;
-	ksem_t *ksem;
-	kobject_t *kobj;
-
-	sem =		*((sem_t **) p);	p += sizeof(sem_t *);
-	pshared =	*((int *) p);		p += sizeof(int);
-	value =		*((uint *) p);
-
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
-
-	proc = kthread_get_process(NULL);
-	sem = U2K_GET_ADR(sem, proc);
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
-
-	kobj = kmalloc_kobject(proc, sizeof(ksem_t));
-	ASSERT_ERRNO_AND_EXIT(kobj, ENOMEM);
-	ksem = kobj->kobject;
-
-	ksem->id = k_new_id();
-	ksem->sem_value = value;
-	ksem->last_lock = NULL;
-	ksem->flags = 0;
-	ksem->ref_cnt = 1;
-	kthreadq_init(&ksem->queue);
-
-	if (pshared)
-		ksem->flags |= PTHREAD_PROCESS_SHARED;
+/*! get kernel address of futex word (NULL if invalid) */
+static int *futex_get_kaddr(int *uaddr)
+{
+	kprocess_t *proc = kthread_get_process(NULL);
 
-	sem->ptr = kobj;
-	sem->id = ksem->id;
+	if (!uaddr || ((aint) uaddr & (sizeof(int) - 1)) ||
+		(aint) uaddr + sizeof(int) > proc->m.size)
+		return NULL;
 
-	EXIT2(EXIT_SUCCESS, EXIT_SUCCESS);
+	return U2K_GET_ADR(uaddr, proc);
 }
 
 /*!
- * Destroy semaphore object
- * \param sem Semaphore descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+ * Block active thread if futex word still has expected value
+ * \param uaddr Address of futex word
+ * \param val Expected value (thread is not blocked if value is changed)
+ * \return 0 if thread was blocked and then woken, -1 with EAGAIN otherwise
  */
-int sys__sem_destroy(void *p)
+int sys__futex_wait(void *p)
 {
-	sem_t *sem;
-
-	kprocess_t *proc;
-	ksem_t *ksem;
-	kobject_t *kobj;
-
-	sem = *((sem_t **) p);
-
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
-
-	proc = kthread_get_process(NULL);
-	sem = U2K_GET_ADR(sem, proc);
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
-
-	kobj = sem->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj->list),
-				EINVAL);
-	ksem = kobj->kobject;
-	ASSERT_ERRNO_AND_EXIT(ksem && ksem->id == sem->id, EINVAL);
+	int *uaddr;
+	int val;
+	int *kaddr;
 
-	ASSERT_ERRNO_AND_EXIT(kthreadq_get(&ksem->queue) == NULL, ENOTEMPTY);
+	uaddr = *((int **) p);		p += sizeof(int *);
+	val = *((int *) p);
 
-	ksem->ref_cnt--;
+	kaddr = futex_get_kaddr(uaddr);
+	if (!kaddr)
+		EXIT2(EINVAL, EXIT_FAILURE);
 
-	/* additional cleanup here (e.g. if semaphore is shared leave it) */
-	if (ksem->ref_cnt)
-		EXIT2(EBUSY, EXIT_FAILURE);
+	/* value changed meanwhile (e.g. lock released) - don't block */
+	if (*kaddr != val)
+		EXIT2(EAGAIN, EXIT_FAILURE);
 
-	kfree_kobject(proc, kobj);
+	SET_ERRNO(EXIT_SUCCESS);
 
-	sem->ptr = NULL;
-	sem->id = 0;
+	kthread_set_private_param(NULL, kaddr);
+	kthread_enqueue(NULL, &futex_queue[FUTEX_HASH(uaddr)], 1, NULL, NULL);
+	kthreads_schedule();
 
-	EXIT2(EXIT_SUCCESS, EXIT_SUCCESS);
+	return EXIT_SUCCESS;
 }
 
 /*!
- * Decrement (lock) semaphore value by 1 (if not 0 when thread is blocked)
- * \param sem Semaphore descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+ * Wake threads blocked on futex
+ * \param uaddr Address of futex word
+ * \param count Maximal number of threads to wake
+ * \return number of released threads
  */
-int sys__sem_wait(void *p)
+int sys__futex_wake(void *p)
 {
-	sem_t *sem;
+	int *uaddr;
+	int count;
+	int *kaddr;
+	kthread_q *q;
+	kthread_t *kthread, *next;
+	int woken = 0;
 
-	kprocess_t *proc;
-	ksem_t *ksem;
-	kobject_t *kobj;
-	kthread_t *kthread;
+	uaddr = *((int **) p);		p += sizeof(int *);
+	count = *((int *) p);
 
-	sem = *((sem_t **) p);
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
+	kaddr = futex_get_kaddr(uaddr);
+	if (!kaddr)
+		EXIT2(EINVAL, EXIT_FAILURE);
 
-	proc = kthread_get_process(NULL);
-	kthread = kthread_get_active();
-	sem = U2K_GET_ADR(sem, proc);
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
+	SET_ERRNO(EXIT_SUCCESS);
 
-	kobj = sem->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj->list),
-				EINVAL);
-	ksem = kobj->kobject;
-	ASSERT_ERRNO_AND_EXIT(ksem && ksem->id == sem->id, EINVAL);
+	q = &futex_queue[FUTEX_HASH(uaddr)];
+	kthread = kthreadq_get(q);
+	while (kthread && woken < count)
+	{
+		next = kthreadq_get_next(kthread);
 
-	kthread_set_errno(kthread, EXIT_SUCCESS);
+		if (kthread_get_private_param(kthread) == kaddr)
+		{
+			(void) kthreadq_remove(q, kthread);
+			kthread_set_private_param(kthread, NULL);
+			kthread_move_to_ready(kthread, LAST);
+			woken++;
+		}
 
-	if (ksem->sem_value > 0)
-	{
-		ksem->sem_value--;
-		ksem->last_lock = kthread;
+		kthread = next;
 	}
-	else {
-		kthread_enqueue(kthread, &ksem->queue, 1, NULL, NULL);
+
+	if (woken)
 		kthreads_schedule();
-	}
 
-	return EXIT_SUCCESS;
+	return woken;
 }
 
 /*!
- * Increment (lock) semaphore value by 1 (or unblock one thread that is blocked)
- * \param sem Semaphore descriptor (user level descriptor)
- * \return 0 if successful, -1 otherwise and appropriate error number is set
+ * Wake some threads blocked on futex and move others to another futex queue
+ * (e.g. on condition variable broadcast, wake one and move the rest to mutex
+ * queue: they will be released one by one as mutex is unlocked, instead of
+ * all becoming ready just to block again on mutex)
+ * \param uaddr Address of futex word where threads are blocked
+ * \param wake Maximal number of threads to wake
+ * \param uaddr2 Address of futex word where to move other threads
+ * \param requeue Maximal number of threads to move
+ * \return number of released and moved threads
  */
-int sys__sem_post(void *p)
+int sys__futex_requeue(void *p)
 {
-	sem_t *sem;
-
-	kprocess_t *proc;
-	ksem_t *ksem;
-	kobject_t *kobj;
-	kthread_t *kthread, *released;
-
-	sem = *((sem_t **) p);
-
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
+	int *uaddr, *uaddr2;
+	int wake, requeue;
+	int *kaddr, *kaddr2;
+	kthread_q *q;
+	kthread_t *kthread, *next;
+	int woken = 0, moved = 0;
+
+	uaddr = *((int **) p);		p += sizeof(int *);
+	wake = *((int *) p);		p += sizeof(int);
+	uaddr2 = *((int **) p);		p += sizeof(int *);
+	requeue = *((int *) p);
+
+	kaddr = futex_get_kaddr(uaddr);
+	kaddr2 = futex_get_kaddr(uaddr2);
+	if (!kaddr || !kaddr2 || kaddr == kaddr2)
+		EXIT2(EINVAL, EXIT_FAILURE);
 
-	proc = kthread_get_process(NULL);
-	kthread = kthread_get_active();
-	sem = U2K_GET_ADR(sem, proc);
-	ASSERT_ERRNO_AND_EXIT(sem, EINVAL);
+	SET_ERRNO(EXIT_SUCCESS);
 
-	kobj = sem->ptr;
-	ASSERT_ERRNO_AND_EXIT(kobj, EINVAL);
-	ASSERT_ERRNO_AND_EXIT(list_find(&proc->kobjects, &kobj->list),
-				EINVAL);
-	ksem = kobj->kobject;
-	ASSERT_ERRNO_AND_EXIT(ksem && ksem->id == sem->id, EINVAL);
+	q = &futex_queue[FUTEX_HASH(uaddr)];
+	kthread = kthreadq_get(q);
+	while (kthread && (woken < wake || moved < requeue))
+	{
+		next = kthreadq_get_next(kthread);
 
-	kthread_set_errno(kthread, EXIT_SUCCESS);
+		if (kthread_get_private_param(kthread) == kaddr)
+		{
+			(void) kthreadq_remove(q, kthread);
 
-	released = kthreadq_get(&ksem->queue); /* first to release */
+			if (woken < wake)
+			{
+				kthread_set_private_param(kthread, NULL);
+				kthread_move_to_ready(kthread, LAST);
+				woken++;
+			}
+			else {
+				kthread_set_private_param(kthread, kaddr2);
+				kthread_enqueue(kthread,
+					&futex_queue[FUTEX_HASH(uaddr2)],
+					1, NULL, NULL);
+				moved++;
+			}
+		}
 
-	if (!released || ksem->sem_value < 0)
-	{
-		/* if initial semaphore value (set by sem_init) was negative,
-		 * semaphore will not release threads until until its value
-		 * reaches zero (small extension of POSIX semaphore) */
-		ksem->sem_value++;
+		kthread = next;
 	}
-	else {
-		kthreadq_release(&ksem->queue);
+
+	if (woken)
 		kthreads_schedule();
-	}
 
-	return EXIT_SUCCESS;
+	return woken + moved;
 }
 
+
 /*! Messages ---------------------------------------------------------------- */
 
 /* list of message queues */
 static list_t kmq_queue = LIST_T_NULL;
 
+/* small messages are from cache, larger from kernel heap */
+static kmq_msg_t *kmq_msg_alloc(size_t msg_len)
+{
+	if (msg_len <= KMQ_SMALL_MSG)
+		return kmem_cache_alloc(&kmq_msg_cache);
+	else
+		return kmalloc(sizeof(kmq_msg_t) + msg_len);
+}
+static void kmq_msg_free(kmq_msg_t *kmq_msg)
+{
+	if (kmq_msg->msg_size <= KMQ_SMALL_MSG)
+		kmem_cache_free(&kmq_msg_cache, kmq_msg);
+	else
+		kfree(kmq_msg);
+}
+
 /*!
  * Open a message queue
  * \param name Queue name
@@ -1052,7 +1063,7 @@ int sys__mq_close(void *p)
 	{
 		/* remove messages */
 		while ((kmq_msg = list_remove(&kq_queue->msg_list,FIRST,NULL)))
-			kfree(kmq_msg);
+			kmq_msg_free(kmq_msg);
 
 		/* remove blocked threads */
 		while ((kthread = kthreadq_remove(&kq_queue->send_q, NULL)))
@@ -1169,7 +1180,7 @@ static int kmq_send(void *p, kthread_t *sender)
 	if (msg_len > kq_queue->attr.mq_msgsize)
 		return EMSGSIZE;
 
-	kmq_msg = kmalloc(sizeof(kmq_msg_t) + msg_len);
+	kmq_msg = kmq_msg_alloc(msg_len);
 	ASSERT_ERRNO_AND_EXIT(kmq_msg, ENOMEM);
 
 	/* create message */
@@ -1305,7 +1316,7 @@ static int kmq_receive(void *p, kthread_t *receiver)
 			*msg_prio = kmq_msg->msg_prio;
 	}
 
-	kfree(kmq_msg);
+	kmq_msg_free(kmq_msg);
 
 	kq_queue->attr.mq_curmsgs--;
 
@@ -4,6 +4,15 @@
 #include <kernel/thread.h>
 #include <lib/list.h>
 
+#include "thread.h"
+
+void kpthread_init();
+
+/*! recalculate thread priority: base + boosts from held PI/PP mutexes */
+void kpthread_mutex_prio_update(kthread_t *kthread);
+/*! thread left PI mutex queue without lock: drop owner's boost from it */
+void kpthread_mutex_wait_abort(kthread_t *kthread);
+
 
 #ifdef	_K_PTHREAD_C_
 
@@ -25,49 +34,15 @@ typedef struct _kpthread_mutex_t_
 
 	kthread_q   queue;
 		    /* queue for blocked threads */
-}
-kpthread_mutex_t;
 
-typedef struct _kpthread_cond_t_
-{
-	id_t	    id;
-		    /* system level id */
-
-	uint	    flags;
-		    /* various flags */
-
-	uint	    ref_cnt;
-		    /* various flags */
-
-	kthread_q   queue;
-		    /* queue for blocked threads */
+	int	    protocol;
+		    /* PTHREAD_PRIO_NONE/INHERIT/PROTECT */
+	int	    prioceiling;
+		    /* priority ceiling for PTHREAD_PRIO_PROTECT */
+	list_h	    list;
+		    /* element in owner's list of held PI/PP mutexes */
 }
-kpthread_cond_t;
-
-
-/*! semaphores -------------------------------------------------------------- */
-
-typedef struct _ksem_t_
-{
-	id_t	    id;
-		    /* system level id */
-
-	int	    sem_value;
-		    /* current semaphore value */
-
-	kthread_t  *last_lock;
-		   /* thread that last called sem_wait and wasn't blocked */
-
-	uint	    flags;
-		    /* various flags */
-
-	uint	    ref_cnt;
-		    /* various flags */
-
-	kthread_q   queue;
-		    /* queue for blocked threads */
-}
-ksem_t;
+kpthread_mutex_t;
 
 
 /*! Messages ---------------------------------------------------------------- */
@@ -86,6 +61,9 @@ typedef struct _kmsg_t_
 }
 kmq_msg_t;
 
+/* messages up to this size are allocated from object cache */
+#define KMQ_SMALL_MSG	64
+
 
 /*! message queue */
 typedef struct _kmq_queue_t_
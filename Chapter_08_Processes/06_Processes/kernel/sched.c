@@ -11,6 +11,12 @@
 #include <types/bits.h>
 #include <lib/list.h>
 
+static void ksched2_init();
+
+/*! ------------------------------------------------------------------------- */
+/*! Master scheduler = priority + FIFO -------------------------------------- */
+/*! ------------------------------------------------------------------------- */
+
 /*! ready threads */
 static sched_ready_t ready;
 
@@ -19,6 +25,11 @@ static sched_ready_t ready;
 #ifdef SCHED_RR_SIMPLE
 #include "time.h"
 static void  ksched_rr_tick(sigval_t sigval);
+static void  ksched_rr_update(kthread_t *active);
+static int   ksched_rr_requeue(kthread_t *kthread);
+#else
+#define ksched_rr_update(active)
+#define ksched_rr_requeue(kthread)	LAST
 #endif
 
 /*! initialize data structure for ready threads */
@@ -31,6 +42,9 @@ void ksched_init()
 
 	ready.mask_len = (ready.prio_levels + UINT_SIZE - 1) / UINT_SIZE;
 	ready.mask = kmalloc(ready.mask_len * sizeof(uint));
+	/* one bit in summary for each mask element */
+	ASSERT(ready.mask_len <= UINT_SIZE);
+	ready.summary = 0;
 
 	/* queue for ready threads is empty */
 	for (i = 0; i < ready.prio_levels; i++)
@@ -39,6 +53,8 @@ void ksched_init()
 	for (i = 0; i < ready.mask_len; i++)
 		ready.mask[i] = 0;
 
+	ksched2_init();
+
 #ifdef SCHED_RR_SIMPLE
 	if (k_feature(FEATURE_SCHED_RR, FEATURE_GET, 0))
 		ksched_rr_start_timer();
@@ -69,6 +85,7 @@ void kthread_move_to_ready(kthread_t *kthread, int where)
 	i = prio / UINT_SIZE;
 	j = prio % UINT_SIZE;
 	ready.mask[i] |= (uint)(1 << j);
+	ready.summary |= (uint)(1 << i);
 }
 
 /*! Remove given thread (its descriptor) from ready threads */
@@ -91,6 +108,8 @@ kthread_t *kthread_remove_from_ready(kthread_t *kthread)
 		j = prio % UINT_SIZE;
 
 		ready.mask[i] &= ~((uint)(1 << j));
+		if (!ready.mask[i])
+			ready.summary &= ~((uint)(1 << i));
 	}
 
 	return kthread;
@@ -101,16 +120,13 @@ static kthread_t *get_first_ready()
 {
 	int i, first;
 
-	for (i = ready.mask_len - 1; i >= 0; i--)
-	{
-		if (ready.mask[i])
-		{
-			first = i * UINT_SIZE + msb_index(ready.mask[i]);
-			return kthreadq_get(&ready.rq[first]);
-		}
-	}
+	if (!ready.summary)
+		return NULL;
+
+	i = msb_index(ready.summary);
+	first = i * UINT_SIZE + msb_index(ready.mask[i]);
 
-	return NULL;
+	return kthreadq_get(&ready.rq[first]);
 }
 
 /*!
@@ -135,11 +151,14 @@ void kthreads_schedule()
 	if (!curr || !kthread_is_active(curr) ||
 		kthread_get_prio(curr) < kthread_get_prio(next))
 	{
-		if (curr)	/* deactivate curr */
+		if (curr && !kthread_is_passive(curr)) /* deactivate curr */
 		{
+			ksched2_deactivate_thread(curr);
+
 			/* move last active to ready queue, if still ready */
 			if (kthread_is_active(curr))
-				kthread_move_to_ready(curr, LAST);
+				kthread_move_to_ready(curr,
+						      ksched_rr_requeue(curr));
 
 			/* deactivation might change ready thread list */
 			next = get_first_ready();
@@ -151,23 +170,161 @@ void kthreads_schedule()
 		ASSERT(next);
 
 		kthread_set_active(next);
+
+		ksched2_activate_thread(next);
 	}
 
 	/* process pending signals (if any) */
 	ksignal_process_pending(kthread_get_active());
 
+	/* start or stop time slice for selected thread */
+	ksched_rr_update(kthread_get_active());
+
 	/* select 'active_thread' context */
 	arch_select_thread(kthread_get_context(NULL));
 }
 
+/*! ------------------------------------------------------------------------- */
+/*! Secondary schedulers ---------------------------------------------------- */
+/*! ------------------------------------------------------------------------- */
+
+extern ksched_t ksched_rr;
+extern ksched_t ksched_edf;
+
+/*!
+ * Statically defined schedulers (could be easily extended to dynamically);
+ * SCHED_FIFO has no secondary scheduler, so for FIFO threads every hook below
+ * is reduced to single array lookup (no indirect call)
+ */
+static ksched_t *ksched[] = {
+	NULL,		/* SCHED_FIFO */
+	&ksched_rr,	/* SCHED_RR */
+	&ksched_edf	/* SCHED_EDF */
+};
+
+/*! Initialize all (known) schedulers (called from 'ksched_init') */
+static void ksched2_init()
+{
+	int i;
+
+	for (i = 0; i < SCHED_NUM; i++)
+		if (ksched[i] && ksched[i]->init)
+			ksched[i]->init(ksched[i]);
+}
+
+/*! Get pointer to ksched_t parameters for requested scheduling policy */
+ksched_t *ksched2_get(int sched_policy)
+{
+	ASSERT(sched_policy >= 0 && sched_policy < SCHED_NUM);
+
+	return ksched[sched_policy];
+}
+
+/*! Add thread to scheduling policy (if required by policy) */
+int ksched2_thread_add(kthread_t *kthread, int sched_policy,
+			 int sched_priority, sched_supp_t *sched_param)
+{
+	kthread_sched2_t *tsched = kthread_get_sched2_param(kthread);
+
+	ASSERT(sched_policy >= 0 && sched_policy < SCHED_NUM);
+
+	tsched->activated = 0;
+
+	if (ksched[sched_policy] && ksched[sched_policy]->thread_add)
+		ksched[sched_policy]->thread_add(
+		ksched[sched_policy], kthread, sched_priority, sched_param);
+
+	return 0;
+}
+
+/*! Remove thread from scheduling policy (if required by policy) */
+int ksched2_thread_remove(kthread_t *kthread)
+{
+	int sched_policy = kthread_get_sched_policy(kthread);
+
+	if (ksched[sched_policy] && ksched[sched_policy]->thread_remove)
+		ksched[sched_policy]->thread_remove(ksched[sched_policy],
+						      kthread);
+
+	return 0;
+}
+
+/*! Actions to be performed when thread is to become active */
+int ksched2_activate_thread(kthread_t *kthread)
+{
+	kthread_sched2_t *tsched = kthread_get_sched2_param(kthread);
+	int activated = tsched->activated;
+	int sched = kthread_get_sched_policy(kthread);
+
+	if (activated == 0)
+	{
+		if (ksched[sched] && ksched[sched]->thread_activate)
+			ksched[sched]->thread_activate(ksched[sched],
+							 kthread);
+
+		tsched->activated = 1;
+	}
+
+	return activated;
+}
+
+/*! Actions to be performed when thread is removed as active */
+int ksched2_deactivate_thread(kthread_t *kthread)
+{
+	kthread_sched2_t *tsched = kthread_get_sched2_param(kthread);
+	int activated = tsched->activated;
+	int sched = kthread_get_sched_policy(kthread);
+
+	if (activated == 1)
+	{
+		if (ksched[sched] && ksched[sched]->thread_deactivate)
+			ksched[sched]->thread_deactivate(ksched[sched],
+							   kthread);
+
+		tsched->activated = 0;
+	}
+
+	return activated;
+}
+
+/*! Change (set) scheduling parameters (extra parameters) */
+int ksched2_setsched_param(kthread_t *kthread, sched_supp_t *sched_param)
+{
+	int sched = kthread_get_sched_policy(kthread);
+
+	if (ksched[sched] && ksched[sched]->set_thread_sched_parameters)
+		return ksched[sched]->set_thread_sched_parameters(
+		ksched[sched], kthread, sched_param);
+
+	return 0;
+}
+
+/*! Reschedule within given scheduler */
+void ksched2_schedule(int sched_policy)
+{
+	ASSERT(sched_policy >= 0 && sched_policy < SCHED_NUM);
+
+	if (ksched[sched_policy] && ksched[sched_policy]->schedule)
+			ksched[sched_policy]->schedule(ksched[sched_policy]);
+}
+
 
 #ifdef SCHED_RR_SIMPLE
+/*
+ * Tickless round robin: time slice timer is armed (as one-shot) only while
+ * active thread has a ready peer with same priority; otherwise there is no one
+ * to share processor with and no timer interrupts are required
+ */
 static ktimer_t *rr_ktimer = NULL;
+static kthread_t *rr_owner;	/* thread whose time slice is measured */
+static timespec_t rr_slice_end;	/* when slice expires (while armed) */
+static timespec_t rr_remainder;	/* unused part of owners slice */
+static int rr_armed;		/* is rr_ktimer armed? */
+static uint rr_slices, rr_expired; /* statistics */
 
 void ksched_rr_start_timer()
 {
 	sigevent_t evp;
-	itimerspec_t itimer;
 	int retval = 0;
 
 	if (rr_ktimer)
@@ -180,28 +337,110 @@ void ksched_rr_start_timer()
 	retval += ktimer_create(CLOCK_REALTIME, &evp, &rr_ktimer, NULL);
 	ASSERT(retval == EXIT_SUCCESS);
 
-	TIME_RESET(&itimer.it_value);
-	itimer.it_value.tv_sec = 0;
-	itimer.it_value.tv_nsec = SCHED_RR_TICK;
-	itimer.it_interval = itimer.it_value;
-
-	retval += ktimer_settime(rr_ktimer, 0, &itimer, NULL);
-	ASSERT(retval == EXIT_SUCCESS);
+	rr_owner = NULL;
+	rr_armed = FALSE;
+	TIME_RESET(&rr_remainder);
 
+	/* timer is armed on next scheduling, if required */
 }
 void ksched_rr_stop_timer()
 {
 	if (rr_ktimer)
 		ktimer_delete(rr_ktimer);
 	rr_ktimer = NULL;
+	rr_owner = NULL;
+	rr_armed = FALSE;
+}
+
+/*! Get number of started and expired time slices */
+void ksched_rr_stats(uint *slices, uint *expired)
+{
+	if (slices)
+		*slices = rr_slices;
+	if (expired)
+		*expired = rr_expired;
+}
+
+/*!
+ * Where to put preempted thread: interrupted slice owner retains its place
+ * (first in its queue) so it can use the rest of the slice later
+ */
+static int ksched_rr_requeue(kthread_t *kthread)
+{
+	if (rr_armed && kthread == rr_owner)
+		return FIRST;
+	else
+		return LAST;
+}
+
+/*!
+ * Start time slice for active thread if it has a peer in ready list (same
+ * priority); stop it (keeping unused part) when owner blocks, is preempted or
+ * when there are no more peers
+ */
+static void ksched_rr_update(kthread_t *active)
+{
+	itimerspec_t itimer;
+	timespec_t now;
+	int peer;
+
+	if (!rr_ktimer)
+		return; /* round robin is disabled */
+
+	peer = active && kthread_is_active(active) &&
+		kthreadq_get(&ready.rq[kthread_get_prio(active)]) != NULL;
+
+	if (rr_armed && (!peer || active != rr_owner))
+	{
+		/* slice interrupted: account unused part and disarm */
+		kclock_gettime(CLOCK_REALTIME, &now);
+		if (time_cmp(&rr_slice_end, &now) > 0)
+		{
+			rr_remainder = rr_slice_end;
+			time_sub(&rr_remainder, &now);
+		}
+		else {
+			TIME_RESET(&rr_remainder);
+		}
+
+		rr_armed = FALSE;
+		TIME_RESET(&itimer.it_interval);
+		TIME_RESET(&itimer.it_value);
+		ktimer_settime(rr_ktimer, 0, &itimer, NULL);
+	}
+
+	if (peer && !rr_armed)
+	{
+		/* owner continues its slice, others get new one */
+		if (active != rr_owner || !TIME_IS_SET(&rr_remainder))
+		{
+			rr_owner = active;
+			rr_remainder.tv_sec = 0;
+			rr_remainder.tv_nsec = SCHED_RR_TICK;
+			rr_slices++;
+		}
+
+		kclock_gettime(CLOCK_REALTIME, &rr_slice_end);
+		time_add(&rr_slice_end, &rr_remainder);
+
+		rr_armed = TRUE; /* set before, timer might expire in settime */
+		TIME_RESET(&itimer.it_interval);
+		itimer.it_value = rr_slice_end;
+		ktimer_settime(rr_ktimer, TIMER_ABSTIME, &itimer, NULL);
+	}
 }
 
 /*!
  * Simple Round-Robin scheduler:
- * - on timer tick move active into ready queue and pick next ready task
+ * - when time slice expires move active into ready queue and pick next ready
+ *   task
  */
 static void  ksched_rr_tick(sigval_t sigval)
 {
+	rr_armed = FALSE;
+	TIME_RESET(&rr_remainder);
+	rr_expired++;
+
 	if (k_feature(FEATURE_SCHED_RR, FEATURE_GET, 0) == 0)
 		return;
 
@@ -13,6 +13,15 @@
 static int ksignal_received_signal(kthread_t *kthread, void *param);
 static void ksignal_add_to_pending(ksignal_handling_t *sh, siginfo_t *sig);
 
+/*! pending signals descriptors */
+static kmem_cache_t ksiginfo_cache;
+
+/*! Initialize signal subsystem */
+void ksignal_init()
+{
+	kmem_cache_init(&ksiginfo_cache, "ksiginfo", sizeof(ksiginfo_t), NULL);
+}
+
 /*! Initialize thread signal handling data */
 int ksignal_thread_init(kthread_t *kthread)
 {
@@ -164,7 +173,7 @@ static void ksignal_add_to_pending(ksignal_handling_t *sh, siginfo_t *sig)
 	ksiginfo_t *ksig;
 
 	/* add signal to list of pending signals */
-	ksig = kmalloc(sizeof(ksiginfo_t));
+	ksig = kmem_cache_alloc(&ksiginfo_cache);
 	ksig->siginfo = *sig;
 
 	list_append(&sh->pending_signals, ksig, &ksig->list);
@@ -194,7 +203,7 @@ int ksignal_process_pending(kthread_t *kthread)
 
 			retval = ksignal_queue(kthread, &ksig->siginfo);
 
-			kfree(ksig);
+			kmem_cache_free(&ksiginfo_cache, ksig);
 
 			/* handle only first signal?
 				* no, all of them - they will mask ... */
@@ -328,7 +337,7 @@ int ksignal_process_event(sigevent_t *evp, kthread_t *kthread, int code)
 						evp->sigev_value.sival_ptr,
 						PTHREAD_CREATE_DETACHED,
 						SCHED_FIFO, THREAD_DEF_PRIO,
-						NULL, 0,
+						NULL, NULL, 0,
 						kthread_get_process(kthread)))
 				retval = EINVAL;
 		}
@@ -545,7 +554,7 @@ int sys__sigwaitinfo(void *p)
 				*info = ksig->siginfo;
 
 			list_remove(&sh->pending_signals, 0, &ksig->list);
-			kfree(ksig);
+			kmem_cache_free(&ksiginfo_cache, ksig);
 
 			EXIT2(EXIT_SUCCESS, retval);
 		}
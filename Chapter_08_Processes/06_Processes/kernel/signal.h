@@ -10,6 +10,7 @@ typedef struct _ksignal_handling_t_ ksignal_handling_t;
 #include "thread.h"
 
 /*! interface to kernel */
+void ksignal_init();
 int ksignal_thread_init(kthread_t *kthread);
 int ksignal_queue(kthread_t *receiver, siginfo_t *sig);
 int ksignal_process_pending(kthread_t *kthread);
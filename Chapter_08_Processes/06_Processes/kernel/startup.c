@@ -40,6 +40,9 @@ void k_startup()
 	/* detect memory faults (qemu do not detect segment violations!) */
 	arch_register_interrupt_handler(INT_MEM_FAULT, k_memory_fault, NULL);
 	arch_register_interrupt_handler(INT_UNDEF_FAULT, k_memory_fault, NULL);
+#ifdef PAGING
+	arch_register_interrupt_handler(INT_PAGE_FAULT, k_page_fault, NULL);
+#endif
 
 	/* timer subsystem */
 	k_time_init();
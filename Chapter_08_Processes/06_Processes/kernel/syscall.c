@@ -56,16 +56,10 @@ static int(*k_sysfunc[SYSFUNCS])(void *params) =
 	sys__pthread_mutex_destroy,
 	sys__pthread_mutex_lock,
 	sys__pthread_mutex_unlock,
-	sys__pthread_cond_init,
-	sys__pthread_cond_destroy,
-	sys__pthread_cond_wait,
-	sys__pthread_cond_signal,
-	sys__pthread_cond_broadcast,
 
-	sys__sem_init,
-	sys__sem_destroy,
-	sys__sem_wait,
-	sys__sem_post,
+	sys__futex_wait,
+	sys__futex_wake,
+	sys__futex_requeue,
 
 	sys__mq_open,
 	sys__mq_close,
@@ -77,7 +71,9 @@ static int(*k_sysfunc[SYSFUNCS])(void *params) =
 	sys__sigqueue,
 	sys__sigwaitinfo,
 
-	sys__posix_spawn
+	sys__posix_spawn,
+	sys__sbrk,
+	sys__prctl
 };
 
 /*!
@@ -6,9 +6,11 @@
 #include "memory.h"
 #include "device.h"
 #include "sched.h"
+#include "pthread.h"
 #include <arch/processor.h>
 #include <arch/interrupt.h>
 #include <arch/syscall.h>
+#include <arch/time.h>
 #include <types/bits.h>
 #include <lib/list.h>
 #include <lib/string.h>
@@ -21,7 +23,19 @@ static kthread_t *active_thread = NULL; /* active thread */
 kprocess_t kernel_proc; /* kernel process (currently only for idle thread) */
 static list_t kprocs; /* list of all processes */
 
+/* caches for thread descriptors and their frequently allocated parts */
+static kmem_cache_t kthread_cache, kthread_state_cache, kthread_cleanup_cache;
+
 static void kthread_remove_descriptor(kthread_t *kthread);
+static void kthread_stack_paint(kprocess_t *kproc, void *stack, size_t size);
+static size_t kthread_stack_used(kprocess_t *kproc, void *stack,
+				   size_t size);
+static size_t kthread_stack_peak(kthread_t *kthread);
+static void kthread_malloc_reclaim(kthread_t *kthread);
+static void kthread_stack_release(kthread_t *kthread);
+
+/* unused (never written) stack words hold this pattern */
+#define STACK_PAINT	0x5a5aa5a5
 /* idle thread */
 static void idle_thread(void *param);
 
@@ -32,6 +46,14 @@ void kthreads_init()
 	list_init(&all_threads);
 	list_init(&kprocs);
 
+	kmem_cache_init(&kthread_cache, "kthread", sizeof(kthread_t), NULL);
+	kmem_cache_init(&kthread_state_cache, "kthread_state",
+			  sizeof(kthread_state_t), NULL);
+	kmem_cache_init(&kthread_cleanup_cache, "kthread_cleanup",
+			  sizeof(kthread_state_cleanup_t), NULL);
+	ksignal_init();
+	kpthread_init();
+
 	active_thread = NULL;
 	ksched_init();
 
@@ -40,9 +62,16 @@ void kthreads_init()
 	kernel_proc.smap = NULL; /* use kernel pool */
 	kernel_proc.m.start = NULL;
 	kernel_proc.m.size = (size_t) 0xffffffff;
+	strcpy(kernel_proc.name, "kernel");
+#ifdef STACK_PEAK
+	kernel_proc.kprog = NULL;
+#endif
+#ifdef PAGING
+	kernel_proc.vm = NULL;
+#endif
 
 	(void) kthread_create(idle_thread, NULL, 0, SCHED_FIFO, 0, NULL,
-				0, &kernel_proc);
+				NULL, 0, &kernel_proc);
 
 	kthreads_schedule();
 }
@@ -79,15 +108,34 @@ kthread_t *kthread_start_process(char *prog_name, void *param, int prio)
 	ASSERT(kproc);
 
 	strcpy(kproc->name, kprog->prog->name);
+#ifdef STACK_PEAK
+	kproc->kprog = kprog;
+#endif
 	kproc->heap_size = kprog->prog->heap_size;
 	kproc->stack_size = kprog->prog->stack_size;
 	kproc->thread_stack_size = kprog->prog->thread_stack;
 	kproc->prio = kprog->prog->prio;
 
-	kproc->m.size = kprog->m->size +
-			kproc->heap_size + kproc->stack_size;
+	kproc->m.size = kprog->size + kproc->heap_size + kproc->stack_size;
 
+#ifndef PAGING
 	kproc->m.start = kmalloc(kproc->m.size);
+	if (!kproc->m.start && kmem_compact())
+		kproc->m.start = kmalloc(kproc->m.size);
+#else
+	/* program is copied to new pages (with XIP instructions are not copied,
+	 * but mapped from module); heap and stack pages are mapped (zeroed)
+	 * on first touch; compressed program is unpacked below (its pages
+	 * are mapped on first touch too) */
+	if (kprog->packed)
+		kproc->vm = arch_vm_create(kproc->m.size, NULL, 0, 0, 0);
+	else
+		kproc->vm = arch_vm_create(kproc->m.size, kprog->m->start,
+					     kprog->size,
+					     (size_t) kprog->prog->text,
+					     (size_t) kprog->prog->text_end);
+	kproc->m.start = kproc->vm ? arch_vm_start(kproc->vm) : NULL;
+#endif
 	if (!kproc->m.start)
 	{
 		LOG(WARN, "Not enough memory for creating a new process!(%d)\n",
@@ -98,15 +146,31 @@ kthread_t *kthread_start_process(char *prog_name, void *param, int prio)
 	kproc->m.type = MS_PROCESS;
 
 	/* copy code and data (memory segment with program) */
-	memcpy(kproc->m.start, kprog->m->start, kprog->m->size);
+	i = 0;
+#ifdef PAGING
+	if (kprog->packed) /* otherwise already copied in arch_vm_create */
+#endif
+		i = k_program_load(kprog, kproc->m.start);
+	if (i)
+	{
+#ifndef PAGING
+		kfree(kproc->m.start);
+#else
+		arch_vm_destroy(kproc->vm);
+#endif
+		kfree(kproc);
+		return NULL;
+	}
 
 	kproc->proc = (void *) kproc->m.start;
 	proc = kproc->proc;
 
-	/* define heap and stack */
-	kproc->heap = (void *) kproc->m.start + kprog->m->size;
-	kproc->stack = kproc->heap + kproc->heap_size;
-	memset(kproc->heap, 0, kproc->heap_size + kproc->stack_size);
+	/* define stack and heap; heap is last so it can grow (sys__sbrk) */
+	kproc->stack = (void *) kproc->m.start + kprog->size;
+	kproc->heap = kproc->stack + kproc->stack_size;
+#ifndef PAGING
+	memset(kproc->stack, 0, kproc->stack_size + kproc->heap_size);
+#endif
 
 	/* initialize bitmap for threads stack management */
 	/* in stack area: kproc->smap_size thread stacks */
@@ -122,8 +186,9 @@ kthread_t *kthread_start_process(char *prog_name, void *param, int prio)
 		kproc->smap[i-1] |= 1<<j;
 
 	/* set addresses in process header to relative/logical addresses */
-	proc->heap = (void *) kprog->m->size;
-	proc->stack = proc->heap + proc->p.heap_size;
+	proc->stack = (void *) kprog->size;
+	proc->heap = proc->stack + proc->p.stack_size;
+	proc->fast_syscall = arch_syscall_fast();
 
 	kproc->thread_count = 0;
 
@@ -172,7 +237,7 @@ kthread_t *kthread_start_process(char *prog_name, void *param, int prio)
 		kfree(param); /* allocated in pthread.c */
 	}
 	kthread = kthread_create(kproc->proc->p.init, args, 0, SCHED_FIFO,
-				   prio, NULL, 0, kproc);
+				   prio, NULL, NULL, 0, kproc);
 
 	list_append(&kprocs, kproc, &kproc->list);
 
@@ -181,19 +246,156 @@ kthread_t *kthread_start_process(char *prog_name, void *param, int prio)
 	return kthread;
 }
 
+#ifndef PAGING
+/*! pointer into process memory moved from 'from' to 'to' (others unchanged) */
+static void *kprocess_moved_ptr(void *ptr, void *from, void *to, size_t size)
+{
+	if (ptr >= from && ptr < from + size)
+		return ptr - from + to;
+
+	return ptr;
+}
+
+/*!
+ * Process memory was moved from 'from' to 'kproc->m.start': update kernel
+ * pointers into it (thread local storage, stacks, parameters saved while
+ * thread is blocked, e.g. for pthread_join and futexes)
+ */
+static void kprocess_moved(kprocess_t *kproc, void *from)
+{
+	kthread_t *kthread;
+	kthread_state_t *state;
+	void *to = kproc->m.start;
+	size_t size = kproc->m.size;
+
+	kproc->proc = to;
+	kproc->heap = kproc->heap - from + to;
+	kproc->stack = kproc->stack - from + to;
+
+	kthread = list_get(&all_threads, FIRST);
+	for (; kthread; kthread = list_get_next(&kthread->all))
+	{
+		if (kthread->proc != kproc)
+			continue;
+
+		kthread->tls = kprocess_moved_ptr(kthread->tls, from, to, size);
+
+		state = &kthread->state;
+		while (state)
+		{
+			state->stack = kprocess_moved_ptr(state->stack,
+							    from, to, size);
+			state->pparam = kprocess_moved_ptr(state->pparam,
+							     from, to, size);
+			arch_set_thread_tls(&state->context, kthread->tls,
+					      sizeof(pthread_tls_t));
+
+			if (state == &kthread->state)
+				state = list_get(&kthread->states, FIRST);
+			else
+				state = list_get_next(&state->list);
+		}
+	}
+}
+
+/*!
+ * Move processes to lowest possible addresses in kernel heap (in order of
+ * their addresses) so that free chunks between them are joined
+ * \return number of moved processes
+ */
+int kprocess_compact()
+{
+	kprocess_t *kproc, *next;
+	void *from, *done = NULL;
+	int moved = 0;
+
+	for (;;)
+	{
+		/* process with lowest address above already processed */
+		next = NULL;
+		kproc = list_get(&kprocs, FIRST);
+		for (; kproc; kproc = list_get_next(&kproc->list))
+			if ((void *) kproc->m.start > done &&
+			    (!next || kproc->m.start < next->m.start))
+				next = kproc;
+
+		if (!next)
+			break;
+
+		from = done = next->m.start;
+
+		next->m.start = kmalloc_below(next->m.size, from);
+		if (!next->m.start)
+		{
+			next->m.start = from;
+			continue;
+		}
+
+		memcpy(next->m.start, from, next->m.size);
+		kfree(from);
+
+		kprocess_moved(next, from);
+		moved++;
+	}
+
+	return moved;
+}
+#endif /* !PAGING */
+
+/*!
+ * Change process size; heap is at process end so it grows or shrinks with it.
+ * Process is extended in place if memory after it is free, otherwise it is
+ * moved (with paging only page mapping limit is changed).
+ * \param kproc Process descriptor
+ * \param size New process size
+ * \return 0 if successful, -1 if there is not enough memory
+ */
+int kprocess_resize(kprocess_t *kproc, size_t size)
+{
+#ifndef PAGING
+	void *from, *to;
+
+	if (size > kproc->m.size && kextend(kproc->m.start, size))
+	{
+		to = kmalloc(size);
+		if (!to && kmem_compact()) /* (this process may be moved too) */
+			to = kmalloc(size);
+		if (!to)
+			return -1;
+
+		from = kproc->m.start;
+		memcpy(to, from, kproc->m.size);
+		kfree(from);
+
+		kproc->m.start = to;
+		kprocess_moved(kproc, from);
+	}
+
+	if (size > kproc->m.size)
+		memset(kproc->m.start + kproc->m.size, 0, size - kproc->m.size);
+#else
+	if (arch_vm_resize(kproc->vm, size))
+		return -1;
+#endif
+	kproc->m.size = size;
+
+	return 0;
+}
+
 /*!
  * Create new thread
  * \param start_routine Starting function for new thread
  * \param arg Parameter sent to starting function
  * \param sched_policy Thread scheduling policy
  * \param sched_priority Thread priority
+ * \param sched_param Supplementary scheduling parameters (for policy)
  * \param stackaddr Address of thread stack (if not NULL)
  * \param stacksize Stack size
  * \param proc Process descriptor thread belongs to
  * \return Pointer to descriptor of created kernel thread
  */
 kthread_t *kthread_create(void *start_routine, void *arg, uint flags,
-	int sched_policy, int sched_priority,
+	int sched_policy, int sched_priority, sched_supp_t *sched_param,
 	void *stackaddr, size_t stacksize, kprocess_t *proc)
 {
 	ASSERT(proc);
@@ -201,7 +403,7 @@ kthread_t *kthread_create(void *start_routine, void *arg, uint flags,
 	kthread_t *kthread;
 
 	/* thread descriptor */
-	kthread = kmalloc(sizeof(kthread_t));
+	kthread = kmem_cache_alloc(&kthread_cache);
 	ASSERT(kthread);
 
 	/* initialize thread descriptor */
@@ -212,6 +414,19 @@ kthread_t *kthread_create(void *start_routine, void *arg, uint flags,
 
 	kthread->queue = NULL;
 	kthreadq_init(&kthread->join_queue);
+	kthread->stack_peak = 0;
+
+	ktimer_sleep_init(&kthread->sleep_timer, kthread);
+
+	/* timer slack is inherited from creating thread (in same process) */
+	if (active_thread && active_thread->proc == proc)
+	{
+		kthread->timer_slack = active_thread->timer_slack;
+	}
+	else {
+		kthread->timer_slack.tv_sec = 0;
+		kthread->timer_slack.tv_nsec = TIMER_SLACK;
+	}
 
 	kthread_create_new_state(kthread, start_routine, arg,
 				   stackaddr, stacksize, FALSE);
@@ -232,10 +447,15 @@ kthread_t *kthread_create(void *start_routine, void *arg, uint flags,
 	if (sched_priority >= PRIO_LEVELS)
 		sched_priority = PRIO_LEVELS - 1;
 	kthread->sched_priority = sched_priority;
+	kthread->base_priority = sched_priority;
+	list_init(&kthread->mutexes);
+	kthread->mutex_wait = NULL;
 
 	kthread->ref_cnt = 1;
 	kthread_move_to_ready(kthread, LAST);
 
+	ksched2_thread_add(kthread, sched_policy, sched_priority, sched_param);
+
 	return kthread;
 }
 
@@ -252,8 +472,9 @@ void kthread_create_new_state(kthread_t *kthread,
 	/* save old state if requested (put it at beginning of state list) */
 	if (save_old_state)
 	{
-		kthread_state_t *state = kmalloc(sizeof(kthread_state_t));
+		kthread_state_t *state = kmem_cache_alloc(&kthread_state_cache);
 		*state = kthread->state;
+		state->errno_saved = kthread->tls->errno;
 		list_prepend(&kthread->states, state, &state->list);
 	}
 
@@ -286,16 +507,25 @@ void kthread_create_new_state(kthread_t *kthread,
 	else {
 		kthread->state.stack = stack;
 		kthread->state.stack_size = stack_size;
+		kthread_stack_paint(kproc, stack, stack_size);
 	}
 
-	/* reserve space for errno in user space */
-	stack_size -= sizeof(int);
-	kthread->state.errno = kthread->state.stack + stack_size;
+	if (!save_old_state)
+	{
+		/* reserve space for thread local storage in user space */
+		stack_size -= sizeof(pthread_tls_t);
+		kthread->tls = stack + stack_size;
+		memset(kthread->tls, 0, sizeof(pthread_tls_t));
+		kthread->tls->self = K2U_GET_ADR(kthread->tls, kproc);
+	}
 
 	arch_create_thread_context(&kthread->state.context, start_func, param,
 				     kproc->proc->p.exit, stack, stack_size, kproc);
+	/* new state (e.g. signal handler) uses the same storage */
+	arch_set_thread_tls(&kthread->state.context, kthread->tls,
+			      sizeof(pthread_tls_t));
 
-	*kthread->state.errno = 0;
+	kthread->tls->errno = 0;
 	kthread->state.exit_status = NULL;
 	kthread->state.pparam = NULL;
 
@@ -313,12 +543,14 @@ int kthread_restore_state(kthread_t *kthread)
 	while ((iter = list_remove(&kthread->state.cleanup, FIRST, NULL)))
 	{
 		iter->cleanup(iter->param1, iter->param2, iter->param3);
-		kfree(iter);
+		kmem_cache_free(&kthread_cleanup_cache, iter);
 	}
 
 	/* release thread stack */
 	if (kthread->state.stack)
 	{
+		kthread_stack_release(kthread);
+
 		if (kthread->proc->smap && kthread->state.stack)
 			kprocess_stack_free(kthread->proc,
 					      kthread->state.stack);
@@ -333,8 +565,12 @@ int kthread_restore_state(kthread_t *kthread)
 	state = list_remove(&kthread->states, FIRST, NULL);
 	if (state)
 	{
+		/* context of discarded state (e.g. signal handler) */
+		arch_destroy_thread_context(&kthread->state.context);
+
 		kthread->state = *state;
-		kfree(state);
+		kthread->tls->errno = state->errno_saved;
+		kmem_cache_free(&kthread_state_cache, state);
 		retval = TRUE;
 	}
 
@@ -383,6 +619,7 @@ static void kthread_release_prematurely(kthread_t *kthread, void *param)
 	{
 		if (!kthreadq_remove(kthread->queue, kthread))
 			ASSERT(FALSE);
+		kpthread_mutex_wait_abort(kthread);
 	}
 	else if (kthread->state.state == THR_STATE_READY)
 	{
@@ -399,7 +636,7 @@ void kthread_add_cleanup(kthread_t *kthread, void *cleanup_function,
 	ASSERT(kthread);
 
 	kthread_state_cleanup_t *cleanup;
-	cleanup = kmalloc(sizeof(kthread_state_cleanup_t));
+	cleanup = kmem_cache_alloc(&kthread_cleanup_cache);
 
 	cleanup->cleanup = cleanup_function;
 	cleanup->param1 = param1;
@@ -455,6 +692,7 @@ int kthread_exit(kthread_t *kthread, void *exit_status, int force)
 		/* remove target 'thread' from its queue */
 		if (!kthreadq_remove(kthread->queue, kthread))
 			ASSERT(FALSE);
+		kpthread_mutex_wait_abort(kthread);
 	}
 	else if (kthread->state.state == THR_STATE_SUSPENDED)
 	{
@@ -472,7 +710,13 @@ int kthread_exit(kthread_t *kthread, void *exit_status, int force)
 		return ESRCH; /* thread descriptor corrupted ! */
 	}
 
+	kthread_malloc_reclaim(kthread);
+
 	kthread->state.state = THR_STATE_PASSIVE;
+
+	/* remove it from its scheduler */
+	ksched2_thread_remove(kthread);
+
 	if (waited > 0 || (kthread->state.flags & PTHREAD_CREATE_DETACHED))
 		kthread->ref_cnt--;
 	kthread->state.exit_status = exit_status;
@@ -488,7 +732,11 @@ int kthread_exit(kthread_t *kthread, void *exit_status, int force)
 
 		kfree_process_kobjects(kthread->proc);
 
+#ifndef PAGING
 		kfree(kthread->proc->m.start);
+#else
+		arch_vm_destroy(kthread->proc->vm);
+#endif
 #ifdef DEBUG
 		ASSERT(kthread->proc ==
 			list_find_and_remove(&kprocs, &kthread->proc->list));
@@ -525,6 +773,124 @@ int kthread_exit(kthread_t *kthread, void *exit_status, int force)
 	return EXIT_SUCCESS;
 }
 
+/*!
+ * Thread ended without pthread_exit (canceled, or by signal) didn't release
+ * its malloc cache: put it on process reclaim list (cache's first word is
+ * link), so that malloc reuses it (api/malloc.c)
+ */
+static void kthread_malloc_reclaim(kthread_t *kthread)
+{
+	process_t *proc = kthread->proc->proc;
+	void **cache;
+
+	if (!proc || !kthread->tls || !kthread->tls->malloc_cache)
+		return;
+
+	cache = U2K_GET_ADR(kthread->tls->malloc_cache, kthread->proc);
+	kthread->tls->malloc_cache = NULL;
+	if (!cache)
+		return;
+
+	*cache = proc->malloc_reclaim;
+	proc->malloc_reclaim = K2U_GET_ADR(cache, kthread->proc);
+}
+
+/*! Stack usage --------------------------------------------------------------
+ * Stacks allocated by kernel are filled with STACK_PAINT when a thread (or
+ * its new state, e.g. signal handler) is created; used part of stack is
+ * from its top (stack grows down) to the lowest overwritten word.
+ * With paging, stacks in process address space are not painted (that would
+ * map all their pages); used part is counted in pages, from the lowest mapped
+ * one (stack reused from process stack heap keeps pages of previous thread).
+ */
+#ifdef PAGING
+#define STACK_PAGED(KPROC, STACK)	\
+((KPROC)->vm && (STACK) >= (KPROC)->m.start && \
+ (STACK) < (KPROC)->m.start + (KPROC)->m.size)
+#endif
+
+static void kthread_stack_paint(kprocess_t *kproc, void *stack, size_t size)
+{
+	uint32 *p = stack, *end = stack + size;
+
+#ifdef PAGING
+	if (STACK_PAGED(kproc, stack))
+		return;
+#endif
+
+	while (p < end)
+		*p++ = STACK_PAINT;
+}
+
+/*! Stack high-water mark: bytes ever used (including thread local storage) */
+static size_t kthread_stack_used(kprocess_t *kproc, void *stack, size_t size)
+{
+	uint32 *p = stack, *end = stack + size;
+
+#ifdef PAGING
+	if (STACK_PAGED(kproc, stack))
+		return arch_vm_mapped_top(kproc->vm, stack, size);
+#endif
+
+	while (p < end && *p == STACK_PAINT)
+		p++;
+
+	return (void *) end - (void *) p;
+}
+
+/*! Largest stack usage of thread: released stacks and current ones */
+static size_t kthread_stack_peak(kthread_t *kthread)
+{
+	kthread_state_t *state;
+	size_t peak = kthread->stack_peak, used;
+
+	if (kthread->state.stack)
+	{
+		used = kthread_stack_used(kthread->proc, kthread->state.stack,
+					    kthread->state.stack_size);
+		if (used > peak)
+			peak = used;
+	}
+
+	for (state = list_get(&kthread->states, FIRST); state;
+	     state = list_get_next(&state->list))
+	{
+		if (!state->stack)
+			continue;
+		used = kthread_stack_used(kthread->proc, state->stack,
+					    state->stack_size);
+		if (used > peak)
+			peak = used;
+	}
+
+	return peak;
+}
+
+/*! Record usage of current state stack (before releasing it) */
+static void kthread_stack_release(kthread_t *kthread)
+{
+	size_t used;
+
+	used = kthread_stack_used(kthread->proc, kthread->state.stack,
+				    kthread->state.stack_size);
+	if (used > kthread->stack_peak)
+		kthread->stack_peak = used;
+
+#ifdef STACK_PEAK
+	kprog_t *kprog = kthread->proc->kprog;
+
+	if (kprog)
+	{
+		if (used > kprog->stack_peak)
+			kprog->stack_peak = used;
+
+		/* thread's last stack: count finished thread */
+		if (!list_get(&kthread->states, FIRST))
+			kprog->stack_threads++;
+	}
+#endif /* STACK_PEAK */
+}
+
 /*! Internal function for removing (freeing) thread descriptor */
 static void kthread_remove_descriptor(kthread_t *kthread)
 {
@@ -539,7 +905,7 @@ static void kthread_remove_descriptor(kthread_t *kthread)
 	(void) list_remove(&all_threads, 0, &kthread->all);
 #endif
 
-	kfree(kthread);
+	kmem_cache_free(&kthread_cache, kthread);
 }
 
 /*!
@@ -728,11 +1094,45 @@ int kthread_set_prio(kthread_t *kthread, int prio)
 	case THR_STATE_PASSIVE: /* report error or just change priority? */
 		kthr->sched_priority = prio;
 		break;
+
+	default: /* other non-runnable states (e.g. suspended) */
+		kthr->sched_priority = prio;
+		break;
 	}
 
 	return old_prio;
 }
 
+int kthread_get_base_prio(kthread_t *kthread)
+{
+	if (!kthread)
+		kthread = active_thread;
+	ASSERT(kthread);
+	return kthread->base_priority;
+}
+
+list_t *kthread_get_mutexes(kthread_t *kthread)
+{
+	if (!kthread)
+		kthread = active_thread;
+	ASSERT(kthread);
+	return &kthread->mutexes;
+}
+void kthread_set_mutex_wait(kthread_t *kthread, void *kmutex)
+{
+	if (!kthread)
+		kthread = active_thread;
+	ASSERT(kthread);
+	kthread->mutex_wait = kmutex;
+}
+void *kthread_get_mutex_wait(kthread_t *kthread)
+{
+	if (!kthread)
+		kthread = active_thread;
+	ASSERT(kthread);
+	return kthread->mutex_wait;
+}
+
 /*! Get-ers, Set-ers and misc ----------------------------------------------- */
 
 int kthread_is_active(kthread_t *kthread)
@@ -830,6 +1230,14 @@ kthread_t *kthread_get_descriptor(pthread_t *thread)
 		return NULL;
 }
 
+void *kthread_get_sched2_param(kthread_t *kthread)
+{
+	if (kthread)
+		return &kthread->sched2;
+	else
+		return &active_thread->sched2;
+}
+
 void *kthread_get_sigparams(kthread_t *kthread)
 {
 	if (!kthread)
@@ -870,6 +1278,35 @@ kthread_q *kthread_get_queue(kthread_t *kthread)
 }
 
 
+/*! Sleep timer (armed only while thread sleeps) */
+void *kthread_get_sleep_timer(kthread_t *kthread)
+{
+	if (!kthread)
+		kthread = active_thread;
+	return &kthread->sleep_timer;
+}
+
+/*! Timer slack for thread's sleep (NULL for slack resets it to default) */
+void kthread_get_timer_slack(kthread_t *kthread, timespec_t *slack)
+{
+	if (!kthread)
+		kthread = active_thread;
+	*slack = kthread->timer_slack;
+}
+void kthread_set_timer_slack(kthread_t *kthread, timespec_t *slack)
+{
+	if (!kthread)
+		kthread = active_thread;
+	if (slack)
+	{
+		kthread->timer_slack = *slack;
+	}
+	else {
+		kthread->timer_slack.tv_sec = 0;
+		kthread->timer_slack.tv_nsec = TIMER_SLACK;
+	}
+}
+
 /*! Temporary storage for blocked thread (save specific context before wait) */
 void kthread_set_private_param(kthread_t *kthread, void *pparam)
 {
@@ -889,23 +1326,23 @@ void *kthread_get_private_param(kthread_t *kthread)
 void kthread_set_errno(kthread_t *kthread, int error_number)
 {
 	if (kthread)
-		*kthread->state.errno = error_number;
+		kthread->tls->errno = error_number;
 	else
-		*active_thread->state.errno = error_number;
+		active_thread->tls->errno = error_number;
 }
 int kthread_get_errno(kthread_t *kthread)
 {
 	if (kthread)
-		return *kthread->state.errno;
+		return kthread->tls->errno;
 	else
-		return *active_thread->state.errno;
+		return active_thread->tls->errno;
 }
 int *kthread_get_errno_ptr(kthread_t *kthread)
 {
 	if (kthread)
-		return kthread->state.errno;
+		return &kthread->tls->errno;
 	else
-		return active_thread->state.errno;
+		return &active_thread->tls->errno;
 }
 void kthread_set_syscall_retval(kthread_t *kthread, int ret_val)
 {
@@ -921,6 +1358,10 @@ int kthread_info()
 {
 	kthread_t *kthread;
 	int i = 1;
+	uint switches, reloads;
+#ifdef SCHED_RR_SIMPLE
+	uint slices, expired;
+#endif /* SCHED_RR_SIMPLE */
 
 	kprintf("Threads info\n");
 
@@ -935,17 +1376,81 @@ int kthread_info()
 	kthread = list_get(&all_threads, FIRST);
 	while (kthread)
 	{
-		kprintf("[%d]\tid=%d(desc. at %x) in process at %x, size=%d\n",
-			 i++, kthread->id, kthread, kthread->proc->m.start,
-			 kthread->proc->m.size);
+		/* (process is released when its last thread exits) */
+		if (kthread->proc)
+			kprintf("[%d]\tid=%d(desc. at %x) in process at %x, "
+				 "size=%d\n", i++, kthread->id, kthread,
+				 kthread->proc->m.start, kthread->proc->m.size);
+		else
+			kprintf("[%d]\tid=%d(desc. at %x), process released\n",
+				 i++, kthread->id, kthread);
 
 		kprintf("\tprio=%d, state=%d, exit_status=%x\n",
 			 kthread->sched_priority, kthread->state.state,
 			 kthread->state.exit_status);
 
+		if (kthread->proc)
+			kprintf("\tprogram=%s, stack used %d of %d\n",
+				 kthread->proc->name,
+				 kthread_stack_peak(kthread),
+				 kthread->proc->smap ?
+				 kthread->proc->thread_stack_size :
+				 kthread->state.stack_size);
+		else
+			kprintf("\tstack used %d\n", kthread->stack_peak);
+
 		kthread = list_get_next(&kthread->all);
 	}
 
+#ifdef STACK_PEAK
+	{
+		extern list_t kprogs;
+		kprog_t *kprog;
+
+		kprintf("Thread stack peak per program (finished threads):\n");
+		for (kprog = list_get(&kprogs, FIRST); kprog;
+		     kprog = list_get_next(&kprog->list))
+		{
+			if (kprog->stack_threads)
+				kprintf("\t%s: %d of %d (%d threads)\n",
+					 kprog->prog->name, kprog->stack_peak,
+					 kprog->prog->thread_stack,
+					 kprog->stack_threads);
+		}
+	}
+#endif /* STACK_PEAK */
+
+	arch_context_stats(&switches, &reloads);
+	kprintf("Thread switches: %d, process segments reloaded: %d, "
+		"reloads avoided: %d\n", switches, reloads, switches - reloads);
+
+	{
+		int tsc_used;
+		uint tsc_khz = arch_tsc_khz(&tsc_used);
+		timespec_t min;
+		uint activated, coalesced;
+
+		arch_get_min_interval(&min);
+		kprintf("Timer interrupts: %d (min. interval %d ns)\n",
+			 arch_timer_interrupts(), min.tv_nsec);
+		ktimer_stats(&activated, &coalesced);
+		kprintf("Timers activated: %d, in interrupt of earlier timer "
+			 "(interrupts avoided with slack): %d\n",
+			 activated, coalesced);
+
+		if (tsc_used)
+			kprintf("Clock source: TSC (%d kHz)\n", tsc_khz);
+		else if (tsc_khz)
+			kprintf("Clock source: timer counter (TSC at %d kHz "
+				 "is not invariant)\n", tsc_khz);
+		else
+			kprintf("Clock source: timer counter\n");
+	}
+#ifdef SCHED_RR_SIMPLE
+	ksched_rr_stats(&slices, &expired);
+	kprintf("Round robin time slices: %d, expired: %d\n", slices, expired);
+#endif /* SCHED_RR_SIMPLE */
+
 	return 0;
 }
 
@@ -963,6 +1468,7 @@ static void idle_thread(void *param)
 int kthread_setschedparam(kthread_t *kthread, int policy, sched_param_t *param)
 {
 	int sched_priority;
+	sched_supp_t *supp;
 
 	ASSERT_ERRNO_AND_EXIT(kthread, EINVAL);
 	ASSERT_ERRNO_AND_EXIT(kthread_is_alive(kthread), ESRCH);
@@ -978,14 +1484,39 @@ int kthread_setschedparam(kthread_t *kthread, int policy, sched_param_t *param)
 			sched_priority = param->sched_priority;
 		else
 			sched_priority = kthread->sched_priority;
+
+		supp = &param->supp;
 	}
 	else {
 		sched_priority = kthread->sched_priority;
+		supp = NULL;
+	}
+
+	/* change in priority? (held mutexes might keep it boosted) */
+	if (kthread->base_priority != sched_priority)
+	{
+		kthread->base_priority = sched_priority;
+		kpthread_mutex_prio_update(kthread);
 	}
 
-	/* change in priority? */
-	if (kthread->sched_priority != sched_priority)
-		kthread_set_prio(kthread, sched_priority);
+	/* change in scheduling policy? */
+	if (kthread->sched_policy != policy)
+	{
+		ksched2_thread_remove(kthread);
+		ksched2_schedule(kthread->sched_policy);
+		kthread->sched_policy = policy;
+		ksched2_thread_add(kthread, policy, sched_priority, supp);
+		ksched2_schedule(kthread->sched_policy);
+
+		/* if still active, start new policy for it (e.g. RR slice) */
+		if (kthread_is_active(kthread))
+			ksched2_activate_thread(kthread);
+	}
+	else if (supp) /* if policy changed, parameters are already given */
+	{
+		/* e.g. EDF_WAIT fails when deadline is already missed */
+		return ksched2_setsched_param(kthread, supp);
+	}
 
 	return EXIT_SUCCESS;
 }
@@ -21,8 +21,12 @@ typedef struct _kthread_t_ kthread_t;
 /*! Interface for kernel (this and other subsystems) ------------------------ */
 void kthreads_init();
 kthread_t *kthread_start_process(char *prog_name, void *param, int prio);
+int kprocess_resize(kprocess_t *kproc, size_t size);
+#ifndef PAGING
+int kprocess_compact();
+#endif
 kthread_t *kthread_create(void *start_routine, void *arg, uint flags,
-	int sched_policy, int sched_priority,
+	int sched_policy, int sched_priority, sched_supp_t *sched_param,
 	void *stackaddr, size_t stacksize, kprocess_t *proc);
 
 /*! insert/restore state for signal handler and similar */
@@ -71,6 +75,14 @@ int kthread_get_sched_policy(kthread_t *kthread);
 int kthread_get_prio(kthread_t *kthread);
 int kthread_set_prio(kthread_t *kthread, int prio);
 
+/*! priority set by thread (without boosts from held mutexes) */
+int kthread_get_base_prio(kthread_t *kthread);
+
+/*! mutexes held (that can boost priority) and mutex thread is blocked on */
+list_t *kthread_get_mutexes(kthread_t *kthread);
+void kthread_set_mutex_wait(kthread_t *kthread, void *kmutex);
+void *kthread_get_mutex_wait(kthread_t *kthread);
+
 /*! Get-ers and Set-ers ----------------------------------------------------- */
 int kthread_is_active(kthread_t *kthread);
 int kthread_is_ready(kthread_t *kthread);
@@ -85,11 +97,21 @@ void *kthread_get_context(kthread_t *thread);
 void *kthread_get_process(kthread_t *kthread);
 kthread_t *kthread_get_descriptor(pthread_t *thr);
 
+/*! Get scheduler specific part of thread descriptor (kthread_sched2_t) */
+void *kthread_get_sched2_param(kthread_t *kthread);
+
 /*! Get signal part of thread descriptor */
 void *kthread_get_sigparams(kthread_t *kthread);
 
 int kthread_get_interruptable(kthread_t *kthread);
 
+/*! timer for thread's sleep (nanosleep), embedded in descriptor */
+void *kthread_get_sleep_timer(kthread_t *kthread);
+
+/*! timer slack for thread's sleep (nanosleep) */
+void kthread_get_timer_slack(kthread_t *kthread, timespec_t *slack);
+void kthread_set_timer_slack(kthread_t *kthread, timespec_t *slack);
+
 /* save extra parameter when blocking thread */
 void kthread_set_private_param(kthread_t *kthread, void *qdata);
 void *kthread_get_private_param(kthread_t *kthread);
@@ -126,8 +148,8 @@ typedef struct _kthread_state_t_
 	context_t  context;
 		   /* storage for thread context */
 
-	int	  *errno;
-		   /* exit status of last system function call */
+	int	   errno_saved;
+		   /* errno while state is saved (otherwise it is in tls) */
 
 	void	  *exit_status;
 		   /* status with which thread exited */
@@ -184,13 +206,30 @@ struct _kthread_t_
 
 	kthread_state_t	    state;
 			    /* thread state, context, ... */
+	pthread_tls_t	   *tls;
+			    /* thread local storage (errno, specific data) */
 	list_t		    states;
 			    /* previously saved states */
+	size_t		    stack_peak;
+			    /* stack high-water mark of released stacks */
+	timespec_t	    timer_slack;
+			    /* allowed delay for sleep timers (prctl) */
+	struct _ktimer_t_   sleep_timer;
+			    /* timer for sleep (reused, not allocated) */
 
 	int		    sched_policy;
 			    /* scheduling policy */
 	int		    sched_priority;
 			    /* priority - primary scheduling parameter */
+	int		    base_priority;
+			    /* priority without boost from held mutexes */
+	list_t		    mutexes;
+			    /* held PI/PP mutexes (that may boost priority) */
+	void		   *mutex_wait;
+			    /* PI mutex thread is blocked on (or NULL) */
+	kthread_sched2_t    sched2;
+			    /* thread scheduling parameters for secondary
+			     * scheduler (depends on scheduling policy) */
 
 	kthread_q	   *queue;
 			    /* in which queue thread is (if not active) */
@@ -15,21 +15,39 @@
 static void kclock_wake_thread(sigval_t sigval);
 static void kclock_interrupt_sleep(kthread_t *kthread, void *param);
 static int ktimer_cmp(void *_a, void *_b);
+static int ktimer_deadline_cmp(void *_a, void *_b);
+static void ktimer_arm(ktimer_t *ktimer);
+static void ktimer_disarm(ktimer_t *ktimer);
 static void ktimer_schedule();
 
-/*! List of active timers */
-static list_t ktimers;
+/*! Timer descriptors */
+static kmem_cache_t ktimer_cache;
+
+/*! Active timers (earliest expiration first) */
+static pheap_t ktimers;
+static uint ktimer_seq; /* arming counter */
+
+/*! Same timers, earliest deadline first (timer interrupt is set for it) */
+static pheap_t kdeadlines;
 
 static timespec_t threshold;
 
+/*! Statistics: activated timers, and those activated in interrupt set for
+ *  an earlier timer (without slack, each would need its own interrupt) */
+static uint ktimer_activated, ktimer_coalesced;
+
 
 /*! Initialize time management subsystem */
 int k_time_init()
 {
 	arch_timer_init();
 
-	/* timer list is empty */
-	list_init(&ktimers);
+	/* no active timers */
+	pheap_init(&ktimers, ktimer_cmp);
+	pheap_init(&kdeadlines, ktimer_deadline_cmp);
+	ktimer_seq = 0;
+	ktimer_activated = ktimer_coalesced = 0;
+	kmem_cache_init(&ktimer_cache, "ktimer", sizeof(ktimer_t), NULL);
 
 	arch_get_min_interval(&threshold);
 	threshold.tv_nsec /= 2;
@@ -83,14 +101,18 @@ static void kclock_wake_thread(sigval_t sigval)
 	if (kthread_check_kthread(kthread) &&
 		kthread_is_suspended(kthread, NULL, NULL))
 	{
-		ktimer = kthread_get_private_param(kthread);
+		ktimer = kthread_get_sleep_timer(kthread);
 		timespec_t *remain = ktimer->param;
-		if (remain)
-			TIME_RESET(remain); /* timer expired */
+		if (remain) /* timer expired */
+		{
+			remain = U2K_GET_ADR(remain,
+					     kthread_get_process(kthread));
+			TIME_RESET(remain);
+		}
 
 		kthread_move_to_ready(kthread, LAST);
 
-		ktimer_delete(ktimer);
+		/* expired timer is already disarmed (it is reused for sleep) */
 	}
 	else {
 		/*
@@ -122,6 +144,9 @@ static void kclock_interrupt_sleep(kthread_t *kthread, void *param)
 
 	if (remain)
 	{
+		/* saved as process address: process might be moved meanwhile */
+		remain = U2K_GET_ADR(remain, kthread_get_process(kthread));
+
 		/* save remaining time */
 		timespec_t now;
 		kclock_gettime(CLOCK_REALTIME, &now);
@@ -130,7 +155,11 @@ static void kclock_interrupt_sleep(kthread_t *kthread, void *param)
 		time_sub(remain, &now);
 	}
 
-	ktimer_delete(ktimer);
+	if (TIMER_IS_ARMED(ktimer))
+	{
+		ktimer_disarm(ktimer);
+		ktimer_schedule();
+	}
 
 	kthread_set_syscall_retval(kthread, EXIT_FAILURE);
 	kthread_set_errno(kthread, EINTR);
@@ -139,16 +168,54 @@ static void kclock_interrupt_sleep(kthread_t *kthread, void *param)
 /*! Timers ------------------------------------------------------------------ */
 
 /*!
- * Compare timers by expiration times (used when inserting new timer in list)
+ * Compare timers by expiration times (used to order active timers); timers
+ * with same expiration time are activated in order they were armed
  * \param a First timer
  * \param b Second timer
- * \return -1 when a < b, 0 when a == b, 1 when a > b
+ * \return -1 when a < b, 1 when a > b
  */
 static int ktimer_cmp(void *_a, void *_b)
 {
 	ktimer_t *a = _a, *b = _b;
+	int cmp;
 
-	return time_cmp(&a->itimer.it_value, &b->itimer.it_value);
+	cmp = time_cmp(&a->itimer.it_value, &b->itimer.it_value);
+	if (cmp)
+		return cmp;
+
+	return (int) (a->seq - b->seq) < 0 ? -1 : 1;
+}
+
+/*! Compare timers by deadlines (expiration + slack) */
+static int ktimer_deadline_cmp(void *_a, void *_b)
+{
+	ktimer_t *a = _a, *b = _b;
+	int cmp;
+
+	cmp = time_cmp(&a->deadline, &b->deadline);
+	if (cmp)
+		return cmp;
+
+	return (int) (a->seq - b->seq) < 0 ? -1 : 1;
+}
+
+/*! Put armed timer (with absolute expiration time) to active timers */
+static void ktimer_arm(ktimer_t *ktimer)
+{
+	ktimer->seq = ktimer_seq++;
+	ktimer->deadline = ktimer->itimer.it_value;
+	time_add(&ktimer->deadline, &ktimer->slack);
+
+	pheap_add(&ktimers, ktimer, &ktimer->heap);
+	pheap_add(&kdeadlines, ktimer, &ktimer->dheap);
+}
+
+/*! Remove timer from active timers */
+static void ktimer_disarm(ktimer_t *ktimer)
+{
+	pheap_remove(&ktimers, &ktimer->heap);
+	pheap_remove(&kdeadlines, &ktimer->dheap);
+	TIMER_DISARM(ktimer);
 }
 
 /*!
@@ -167,7 +234,7 @@ int ktimer_create(clockid_t clockid, sigevent_t *evp, ktimer_t **_ktimer,
 	ASSERT(evp && _ktimer);
 	/* add other checks on evp if required */
 
-	ktimer = kmalloc(sizeof(ktimer_t));
+	ktimer = kmem_cache_alloc(&ktimer_cache);
 	ASSERT(ktimer);
 
 	ktimer->id = k_new_id();
@@ -177,11 +244,42 @@ int ktimer_create(clockid_t clockid, sigevent_t *evp, ktimer_t **_ktimer,
 	TIMER_DISARM(ktimer);
 	ktimer->param = NULL;
 
+	if (evp->sigev_notify & SIGEV_SLACK)
+	{
+		ktimer->evp.sigev_notify &= ~SIGEV_SLACK;
+		ktimer->slack = evp->sigev_slack;
+	}
+	else {
+		TIME_RESET(&ktimer->slack);
+	}
+
 	*_ktimer = ktimer;
 
 	return EXIT_SUCCESS;
 }
 
+/*!
+ * Initialize sleep timer embedded in thread descriptor: it is armed for each
+ * sleep, so sleep requires no allocation (and no id: threads can't see it)
+ * \param ktimer	Timer
+ * \param kthread	Thread owning the timer
+ */
+void ktimer_sleep_init(ktimer_t *ktimer, void *kthread)
+{
+	ASSERT(ktimer && kthread);
+
+	ktimer->id = 0;
+	ktimer->clockid = CLOCK_REALTIME;
+	ktimer->evp.sigev_notify = SIGEV_WAKE_THREAD;
+	ktimer->evp.sigev_value.sival_ptr = kthread;
+	ktimer->evp.sigev_notify_function = kclock_wake_thread;
+	ktimer->owner = kthread;
+	TIMER_DISARM(ktimer);
+	TIME_RESET(&ktimer->itimer.it_interval);
+	TIME_RESET(&ktimer->slack);
+	ktimer->param = NULL;
+}
+
 /*!
  * Delete timer
  * \param ktimer	Timer to delete
@@ -202,12 +300,12 @@ int ktimer_delete(ktimer_t *ktimer)
 	/* remove from active timers (if it was there) */
 	if (TIMER_IS_ARMED(ktimer))
 	{
-		list_remove(&ktimers, 0, &ktimer->list);
+		ktimer_disarm(ktimer);
 		ktimer_schedule();
 	}
 
 	k_free_id(ktimer->id);
-	kfree(ktimer);
+	kmem_cache_free(&ktimer_cache, ktimer);
 
 	return EXIT_SUCCESS;
 }
@@ -240,10 +338,7 @@ int ktimer_settime(ktimer_t *ktimer, int flags, itimerspec_t *value,
 
 	/* first disarm timer, if it was armed */
 	if (TIMER_IS_ARMED(ktimer))
-	{
-		TIMER_DISARM(ktimer);
-		list_remove(&ktimers, 0, &ktimer->list);
-	}
+		ktimer_disarm(ktimer);
 
 	if (value && TIME_IS_SET(&value->it_value))
 	{
@@ -252,7 +347,7 @@ int ktimer_settime(ktimer_t *ktimer, int flags, itimerspec_t *value,
 		if (!(flags & TIMER_ABSTIME)) /* convert to absolute time */
 			time_add(&ktimer->itimer.it_value, &now);
 
-		list_sort_add(&ktimers, ktimer, &ktimer->list, ktimer_cmp);
+		ktimer_arm(ktimer);
 	}
 
 	ktimer_schedule();
@@ -282,12 +377,28 @@ int ktimer_gettime(ktimer_t *ktimer, itimerspec_t *value)
 	return EXIT_SUCCESS;
 }
 
-/*! Activate timers and reschedule threads if required */
+/*!
+ * Get timer statistics
+ * \param activated	Number of activated timers
+ * \param coalesced	Number of timers activated in timer interrupt set for
+ *			earlier timer (thanks to slack)
+ */
+void ktimer_stats(uint *activated, uint *coalesced)
+{
+	*activated = ktimer_activated;
+	*coalesced = ktimer_coalesced;
+}
+
+/*!
+ * Activate timers and reschedule threads if required.
+ * Timer interrupt is set for earliest deadline (expiration + slack); then all
+ * expired timers are activated, also those whose slack isn't used up yet.
+ */
 static void ktimer_schedule()
 {
 	ktimer_t *first;
-	timespec_t time, ref_time;
-	int resched = 0;
+	timespec_t time, ref_time, last = {0, 0};
+	int resched = 0, activated = 0;
 
 	if (!k_feature(FEATURE_TIMERS, FEATURE_GET, 0))
 		return;
@@ -300,7 +411,7 @@ static void ktimer_schedule()
 	/* use "ref_time" instead of "time" when looking timers to activate */
 
 	/* should any timer be activated? */
-	first = list_get(&ktimers, FIRST);
+	first = pheap_get_first(&ktimers);
 	while (first != NULL)
 	{
 		/* timers have absolute values in 'it_value' */
@@ -308,18 +419,27 @@ static void ktimer_schedule()
 		{
 			/* 'activate' timer */
 
-			/* but first remove timer from list */
-			first = list_remove(&ktimers, FIRST, NULL);
+			/* but first remove timer from active timers */
+			first = pheap_remove_first(&ktimers);
+			pheap_remove(&kdeadlines, &first->dheap);
+
+			/* would it require another interrupt, without slack? */
+			ktimer_activated++;
+			if (activated++)
+			{
+				time_add(&last, &threshold);
+				if (time_cmp(&first->itimer.it_value, &last) > 0)
+					ktimer_coalesced++;
+			}
+			last = first->itimer.it_value;
 
-			/* and add to list if period is given */
+			/* and add it back if period is given */
 			if (TIME_IS_SET(&first->itimer.it_interval))
 			{
 				/* calculate next activation time */
 				time_add(&first->itimer.it_value,
 					   &first->itimer.it_interval);
-				/* put back into list */
-				list_sort_add(&ktimers, first,
-						&first->list, ktimer_cmp);
+				ktimer_arm(first);
 			}
 			else {
 				TIMER_DISARM(first);
@@ -342,17 +462,17 @@ static void ktimer_schedule()
 				}
 			}
 
-			first = list_get(&ktimers, FIRST);
+			first = pheap_get_first(&ktimers);
 		}
 		else {
 			break;
 		}
 	}
 
-	first = list_get(&ktimers, FIRST);
+	first = pheap_get_first(&kdeadlines);
 	if (first)
 	{
-		ref_time = first->itimer.it_value;
+		ref_time = first->deadline;
 		time_sub(&ref_time, &time);
 		arch_timer_set(&ref_time, ktimer_schedule);
 	}
@@ -438,7 +558,6 @@ int sys__clock_nanosleep(void *p)
 	int retval = EXIT_SUCCESS;
 	kthread_t *kthread = kthread_get_active();
 	ktimer_t *ktimer;
-	sigevent_t evp;
 	itimerspec_t itimer;
 
 	clockid =	*((clockid_t *) p);	p += sizeof(clockid_t);
@@ -457,23 +576,18 @@ int sys__clock_nanosleep(void *p)
 
 	/* Timers are used for "sleep" operations through steps 1-4 */
 
-	/* 1. create timer, but not arm it yet */
-	evp.sigev_notify = SIGEV_WAKE_THREAD;
-	evp.sigev_value.sival_ptr = kthread;
-	evp.sigev_notify_function = kclock_wake_thread;
-
-	retval += ktimer_create(clockid, &evp, &ktimer, kthread);
-	ASSERT(retval == EXIT_SUCCESS);
+	/* 1. prepare thread's sleep timer (not armed, sleep isn't nested) */
+	ktimer = kthread_get_sleep_timer(kthread);
+	ASSERT(!TIMER_IS_ARMED(ktimer));
+	ktimer->clockid = clockid;
 
 	/* save remainder location, if provided */
-	if (remain)
-	{
-		remain =  U2K_GET_ADR(remain, kthread_get_process(NULL));
-		ktimer->param = remain;
-	}
+	ktimer->param = remain;
+
+	/* sleep may last longer, up to thread's timer slack */
+	kthread_get_timer_slack(kthread, &ktimer->slack);
 
 	/* 2. suspend thread */
-	kthread_set_private_param(kthread, ktimer);
 	retval += kthread_suspend(kthread, kclock_interrupt_sleep, ktimer);
 	ASSERT(retval == EXIT_SUCCESS);
 
@@ -519,6 +633,10 @@ int sys__timer_create(void *p)
 	evp = U2K_GET_ADR(evp, proc);
 	timerid = U2K_GET_ADR(timerid, proc);
 	ASSERT_ERRNO_AND_EXIT(evp && timerid, EINVAL);
+	ASSERT_ERRNO_AND_EXIT(!(evp->sigev_notify & SIGEV_SLACK) ||
+		(evp->sigev_slack.tv_sec >= 0 &&
+		 evp->sigev_slack.tv_nsec >= 0 &&
+		 evp->sigev_slack.tv_nsec < 1000000000L), EINVAL);
 
 	retval = ktimer_create(clockid, evp, &ktimer, kthread_get_active());
 	if (retval == EXIT_SUCCESS)
@@ -21,17 +21,18 @@ int ktimer_delete(ktimer_t *ktimer);
 int ktimer_settime(ktimer_t *ktimer, int flags, itimerspec_t *value,
 		   itimerspec_t *ovalue);
 int ktimer_gettime(ktimer_t *ktimer, itimerspec_t *value);
+void ktimer_stats(uint *activated, uint *coalesced);
+
+/*! sleep timer, embedded in thread descriptor (reused for every sleep) */
+void ktimer_sleep_init(ktimer_t *ktimer, void *kthread);
 
 /* signal notification type for wakeup */
 #define	SIGEV_WAKE_THREAD	(SIGEV_THREAD_ID + 1)
 
+#include <lib/pheap.h>
 
-#ifdef	_K_TIME_C_
-/*! rest of the file is only for 'kernel/timer.c' --------------------------- */
-
-#include <lib/list.h>
-
-/*! Kernel timer */
+/*! Kernel timer (fields are used only in 'kernel/time.c'; visible so it can
+ *  be embedded in other descriptors) */
 struct _ktimer_t_
 {
 	id_t	      id;
@@ -49,10 +50,24 @@ struct _ktimer_t_
 	void	     *param;
 		      /* additional parameter (remainder for sleep)*/
 
-	list_h	      list;
-		      /* active timers are in sorted list */
+	timespec_t    slack;
+		      /* timer may be activated up to 'slack' after expiration */
+	timespec_t    deadline;
+		      /* expiration + slack (when armed) */
+
+	uint	      seq;
+		      /* arming order (for timers with same expiration) */
+
+	pheap_h	      heap;
+		      /* active timers are in heap, by expiration */
+	pheap_h	      dheap;
+		      /* and in another one, by deadline */
 };
 
+
+#ifdef	_K_TIME_C_
+/*! rest of the file is only for 'kernel/timer.c' --------------------------- */
+
 #define TIMER_IS_ARMED(T)	TIME_IS_SET(& (T)->itimer.it_value)
 #define TIMER_DISARM(T)		TIME_RESET(& (T)->itimer.it_value)
 
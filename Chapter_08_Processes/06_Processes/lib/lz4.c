@@ -0,0 +1,88 @@
+/*! LZ4 decompression (block format) */
+
+#include <lib/lz4.h>
+#include <lib/string.h>
+
+#define MIN_MATCH	4
+
+/*! Read length continuation bytes (after 15 in token); 0 if input ends */
+static inline size_t read_length(const uint8 **ip, const uint8 *iend,
+				   size_t len)
+{
+	uint8 b;
+
+	do {
+		if (*ip >= iend)
+			return 0;
+		b = *(*ip)++;
+		len += b;
+	}
+	while (b == 255);
+
+	return len;
+}
+
+/*!
+ * Decompress block
+ * \param src Compressed block
+ * \param src_size Compressed block size
+ * \param dst Where to put decompressed data
+ * \param dst_size Space in 'dst'
+ * \return decompressed size, -1 if block is corrupted or 'dst' too small
+ */
+int lz4_decompress(const void *src, size_t src_size,
+		     void *dst, size_t dst_size)
+{
+	const uint8 *ip = src, *iend = ip + src_size, *match;
+	uint8 *op = dst, *oend = op + dst_size;
+	size_t len, offset;
+	uint token;
+
+	while (ip < iend)
+	{
+		token = *ip++;
+
+		/* literals */
+		len = token >> 4;
+		if (len == 15 && !(len = read_length(&ip, iend, len)))
+			return -1;
+		if (len > iend - ip || len > oend - op)
+			return -1;
+
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+
+		if (ip == iend)
+			break; /* last sequence: literals only */
+
+		/* match */
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (!offset || offset > op - (uint8 *) dst)
+			return -1;
+
+		len = token & 15;
+		if (len == 15 && !(len = read_length(&ip, iend, len)))
+			return -1;
+		len += MIN_MATCH;
+		if (len > oend - op)
+			return -1;
+
+		match = op - offset;
+		if (offset >= len)
+		{
+			memcpy(op, match, len);
+			op += len;
+		}
+		else {
+			/* overlapping: repeats last 'offset' bytes */
+			while (len--)
+				*op++ = *match++;
+		}
+	}
+
+	return op - (uint8 *) dst;
+}
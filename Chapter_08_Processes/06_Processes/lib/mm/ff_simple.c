@@ -15,25 +15,49 @@
 */
 void *ffs_init(void *mem_segm, size_t size)
 {
-	size_t start, end;
-	ffs_hdr_t *chunk, *border;
+	size_t start;
 	ffs_mpool_t *mpool;
 
 	ASSERT(mem_segm && size > sizeof(ffs_hdr_t) * 2);
 
 	/* align all on 'size_t' (if already not aligned) */
 	start = (size_t) mem_segm;
-	end = start + size;
 	ALIGN_FW(start);
 	mpool = (void *) start;		/* place mm descriptor here */
 	start += sizeof(ffs_mpool_t);
-	ALIGN(end);
 
 	mpool->first = NULL;
 
-	if (end - start < 2 * HEADER_SIZE)
+	if (ffs_add(mpool, (void *) start,
+		      (size_t) mem_segm + size - start))
 		return NULL;
 
+	return mpool;
+}
+
+/*!
+ * Add memory region to pool (pool may consist of non-contiguous regions)
+ * \param mpool Memory pool to be used
+ * \param mem_segm Region start address
+ * \param size Region size
+ * \return 0 if successful, -1 if region is too small
+ */
+int ffs_add(ffs_mpool_t *mpool, void *mem_segm, size_t size)
+{
+	size_t start, end;
+	ffs_hdr_t *chunk, *border;
+
+	ASSERT(mpool && mem_segm);
+
+	start = (size_t) mem_segm;
+	end = start + size;
+	ALIGN_FW(start);
+	ALIGN(end);
+
+	if (end < start || end - start < 2 * HEADER_SIZE)
+		return -1;
+
+	/* borders are marked as used: chunks never join across regions */
 	border = (ffs_hdr_t *) start;
 	border->size = sizeof(size_t);
 	MARK_USED(border);
@@ -47,9 +71,9 @@ void *ffs_init(void *mem_segm, size_t size)
 	border->size = sizeof(size_t);
 	MARK_USED(border);
 
-	ffs_insert_chunk(mpool, chunk); /* first and only free chunk */
+	ffs_insert_chunk(mpool, chunk);
 
-	return mpool;
+	return 0;
 }
 
 /*!
@@ -145,6 +169,126 @@ int ffs_free(ffs_mpool_t *mpool, void *chunk_to_be_freed)
 	return 0;
 }
 
+/*!
+ * Extend used chunk in place, by taking (part of) free chunk right after it
+ * \param mpool Memory pool to be used
+ * \param chunk_to_extend Chunk location (as returned by ffs_alloc)
+ * \param size Requested size
+ * \return 0 if successful, -1 if chunk can't be extended in place
+ */
+int ffs_extend(ffs_mpool_t *mpool, void *chunk_to_extend, size_t size)
+{
+	ffs_hdr_t *chunk, *after, *rest;
+	size_t need;
+
+	ASSERT(mpool && chunk_to_extend);
+
+	chunk = chunk_to_extend - sizeof(size_t);
+	ASSERT(CHECK_USED(chunk));
+
+	size += sizeof(size_t) * 2; /* add header and tail size */
+	if (size < HEADER_SIZE)
+		size = HEADER_SIZE;
+	ALIGN_FW(size);
+
+	if (GET_SIZE(chunk) >= size)
+		return 0; /* already large enough */
+
+	after = GET_AFTER(chunk);
+	if (CHECK_USED(after) || GET_SIZE(chunk) + after->size < size)
+		return -1;
+
+	need = size - GET_SIZE(chunk);
+	ffs_remove_chunk(mpool, after);
+
+	if (after->size >= need + HEADER_SIZE)
+	{
+		/* split: rest of right neighbor remains free */
+		rest = ((void *) after) + need;
+		rest->size = after->size - need;
+		CLONE_SIZE_TO_TAIL(rest);
+		ffs_insert_chunk(mpool, rest);
+
+		chunk->size = size;
+	}
+	else { /* take whole right neighbor */
+		chunk->size = GET_SIZE(chunk) + after->size;
+	}
+
+	MARK_USED(chunk);
+	CLONE_SIZE_TO_TAIL(chunk);
+
+	return 0;
+}
+
+/*!
+ * Get free chunk at lowest address below 'limit' (for moving used chunks down
+ * when compacting pool); block is taken from start of free chunk
+ * \param mpool Memory pool to be used
+ * \param size Requested chunk size
+ * \param limit Chunk must start below this address
+ * \return Block address, NULL if can't find adequate free chunk
+ */
+void *ffs_alloc_below(ffs_mpool_t *mpool, size_t size, void *limit)
+{
+	ffs_hdr_t *iter, *chunk, *rest;
+
+	ASSERT(mpool);
+
+	size += sizeof(size_t) * 2; /* add header and tail size */
+	if (size < HEADER_SIZE)
+		size = HEADER_SIZE;
+	ALIGN_FW(size);
+
+	chunk = NULL;
+	for (iter = mpool->first; iter != NULL; iter = iter->next)
+		if (iter->size >= size && (void *) iter < limit &&
+		    (!chunk || iter < chunk))
+			chunk = iter;
+
+	if (chunk == NULL)
+		return NULL;
+
+	ffs_remove_chunk(mpool, chunk);
+
+	if (chunk->size >= size + HEADER_SIZE)
+	{
+		/* split: second part remains free */
+		rest = ((void *) chunk) + size;
+		rest->size = chunk->size - size;
+		CLONE_SIZE_TO_TAIL(rest);
+		ffs_insert_chunk(mpool, rest);
+
+		chunk->size = size;
+	}
+
+	MARK_USED(chunk);
+	CLONE_SIZE_TO_TAIL(chunk);
+
+	return ((void *) chunk) + sizeof(size_t);
+}
+
+/*!
+ * Free memory statistics
+ * \param mpool Memory pool to be used
+ * \param free Sum of free chunks sizes (headers included)
+ * \param largest Size of largest free chunk (headers included)
+ */
+void ffs_stat(ffs_mpool_t *mpool, size_t *free, size_t *largest)
+{
+	ffs_hdr_t *iter;
+
+	ASSERT(mpool);
+
+	*free = *largest = 0;
+	for (iter = mpool->first; iter != NULL; iter = iter->next)
+	{
+		*free += iter->size;
+		if (iter->size > *largest)
+			*largest = iter->size;
+	}
+}
+
 /*!
  * Routine that removes a chunk from 'free' list (free_list)
  * \param mpool Memory pool to be used
@@ -53,6 +53,8 @@ gma_t *gma_init(void *memory_segment, size_t size, size_t min_chunk_size,
 
 	levels = mpool->fl_max - mpool->fl_min + 1;
 
+	mpool->FL_bitmap = 0; /* pool might be reinitialized */
+
 	mpool->SL_bitmap = (size_t *) addr;
 	addr = CHUNK_ALIGN_FW(addr + sizeof(size_t) * levels);
 	for (i = 0; i < levels; i++)
@@ -0,0 +1,105 @@
+/*! Object cache (slab allocator) for fixed size objects */
+
+#include <lib/slab.h>
+
+#ifndef ASSERT
+#include ASSERT_H
+#endif
+
+/* free list link is placed at end of slot */
+#define SLOT_ALIGN		sizeof(void *)
+#define LINK(CACHE, OBJ)	\
+	(*((void **) ((OBJ) + (CACHE)->slot_size - sizeof(void *))))
+
+/*!
+ * Initialize object cache (no memory is allocated until first allocation)
+ * \param cache Cache descriptor
+ * \param name Cache name
+ * \param obj_size Size of objects in cache
+ * \param ctor Constructor called for every object when its slab is added
+ * \param alloc Backing allocator for slabs
+ */
+void slab_cache_init(slab_cache_t *cache, char *name, size_t obj_size,
+		       void (*ctor)(void *obj), void *(*alloc)(size_t size))
+{
+	ASSERT(cache && obj_size && alloc);
+
+	cache->name = name;
+	cache->obj_size = obj_size;
+	cache->slot_size = obj_size + sizeof(void *);
+	cache->slot_size = (cache->slot_size + SLOT_ALIGN - 1) &
+			   ~(SLOT_ALIGN - 1);
+
+	cache->slab_objs = SLAB_SIZE / cache->slot_size;
+	if (cache->slab_objs < SLAB_MIN_OBJS)
+		cache->slab_objs = SLAB_MIN_OBJS;
+
+	cache->ctor = ctor;
+	cache->alloc = alloc;
+	cache->free = NULL;
+	cache->slabs = 0;
+	cache->in_use = 0;
+	cache->next = NULL;
+}
+
+/*! Add new slab to cache: construct its objects and put them in free list */
+static int slab_grow(slab_cache_t *cache)
+{
+	void *slab, *obj;
+	uint i;
+
+	slab = cache->alloc(cache->slab_objs * cache->slot_size);
+	if (!slab)
+		return FALSE;
+
+	/* link in reverse, so that objects are given from slab start */
+	for (i = cache->slab_objs; i > 0; i--)
+	{
+		obj = slab + (i - 1) * cache->slot_size;
+
+		if (cache->ctor)
+			cache->ctor(obj);
+
+		LINK(cache, obj) = cache->free;
+		cache->free = obj;
+	}
+
+	cache->slabs++;
+
+	return TRUE;
+}
+
+/*!
+ * Allocate object from cache
+ * \param cache Cache descriptor
+ * \return Object address, NULL if there is no more memory
+ */
+void *slab_alloc(slab_cache_t *cache)
+{
+	void *obj;
+
+	ASSERT(cache);
+
+	if (!cache->free && !slab_grow(cache))
+		return NULL;
+
+	obj = cache->free;
+	cache->free = LINK(cache, obj);
+	cache->in_use++;
+
+	return obj;
+}
+
+/*!
+ * Return object to cache
+ * \param cache Cache descriptor
+ * \param obj Object allocated with slab_alloc from same cache
+ */
+void slab_free(slab_cache_t *cache, void *obj)
+{
+	ASSERT(cache && obj && cache->in_use);
+
+	LINK(cache, obj) = cache->free;
+	cache->free = obj;
+	cache->in_use--;
+}
@@ -0,0 +1,146 @@
+/*!
+ * Pairing heap (priority queue)
+ *
+ * properties:
+ * - heap is a tree: element is not larger than any of its children; children
+ *   of an element are in double linked list
+ * - two heaps are joined (melded) by making larger root first child of
+ *   smaller one; when root is removed, its children are melded in pairs left
+ *   to right, then those right to left (two-pass)
+ */
+
+#include <lib/pheap.h>
+
+#include ASSERT_H
+
+static pheap_h *pheap_meld(pheap_t *heap, pheap_h *a, pheap_h *b);
+static pheap_h *pheap_merge_pairs(pheap_t *heap, pheap_h *first);
+
+void pheap_init(pheap_t *heap, int (*cmp)(void *, void *))
+{
+	ASSERT(heap && cmp);
+
+	heap->root = NULL;
+	heap->cmp = cmp;
+}
+
+void pheap_add(pheap_t *heap, void *object, pheap_h *hdr)
+{
+	ASSERT(heap && object && hdr);
+
+	hdr->object = object;
+	hdr->child = hdr->next = hdr->prev = NULL;
+
+	heap->root = pheap_meld(heap, heap->root, hdr);
+}
+
+void *pheap_get_first(pheap_t *heap)
+{
+	ASSERT(heap);
+
+	return heap->root ? heap->root->object : NULL;
+}
+
+void *pheap_remove_first(pheap_t *heap)
+{
+	pheap_h *first;
+
+	ASSERT(heap);
+
+	first = heap->root;
+	if (!first)
+		return NULL;
+
+	heap->root = pheap_merge_pairs(heap, first->child);
+	first->child = NULL;
+
+	return first->object;
+}
+
+void *pheap_remove(pheap_t *heap, pheap_h *hdr)
+{
+	pheap_h *sub;
+
+	ASSERT(heap && hdr);
+
+	if (hdr == heap->root)
+		return pheap_remove_first(heap);
+
+	/* unlink subheap with 'hdr' as root from its parent */
+	if (hdr->prev->child == hdr)
+		hdr->prev->child = hdr->next;
+	else
+		hdr->prev->next = hdr->next;
+	if (hdr->next)
+		hdr->next->prev = hdr->prev;
+
+	/* put its children back */
+	sub = pheap_merge_pairs(heap, hdr->child);
+	heap->root = pheap_meld(heap, heap->root, sub);
+
+	hdr->child = hdr->next = hdr->prev = NULL;
+
+	return hdr->object;
+}
+
+/*! Join two heaps ('a' and 'b' are roots, without siblings) */
+static pheap_h *pheap_meld(pheap_t *heap, pheap_h *a, pheap_h *b)
+{
+	pheap_h *tmp;
+
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+
+	if (heap->cmp(b->object, a->object) < 0)
+	{
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* 'b' becomes first child of 'a' */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child)
+		a->child->prev = b;
+	a->child = b;
+
+	return a;
+}
+
+/*! Join list of siblings starting with 'first' into single heap */
+static pheap_h *pheap_merge_pairs(pheap_t *heap, pheap_h *first)
+{
+	pheap_h *a, *b, *pairs = NULL, *root = NULL;
+
+	/* first pass: meld pairs, left to right (result list is reversed) */
+	while (first)
+	{
+		a = first;
+		b = a->next;
+		first = b ? b->next : NULL;
+
+		a->next = a->prev = NULL;
+		if (b)
+		{
+			b->next = b->prev = NULL;
+			a = pheap_meld(heap, a, b);
+		}
+
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* second pass: meld them into one, right to left */
+	while (pairs)
+	{
+		a = pairs;
+		pairs = a->next;
+		a->next = NULL;
+		root = pheap_meld(heap, root, a);
+	}
+
+	return root;
+}
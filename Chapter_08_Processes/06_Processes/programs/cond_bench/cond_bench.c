@@ -0,0 +1,102 @@
+/*! Condition variable broadcast: wake all waiters vs. requeue to mutex */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <syscall.h>
+
+char PROG_HELP[] = "Producer/consumers: broadcast that wakes all consumers "
+		   "vs. broadcast that moves them to mutex queue.";
+
+#define CONSUMERS	8
+#define ROUNDS		1000	/* broadcasts per measurement */
+#define INFO_SIZE	100
+
+static pthread_mutex_t mutex;
+static pthread_cond_t cond;
+static int items, done;
+
+/* consumers have higher priority: they run as soon as they are released */
+static void *consumer(void *param)
+{
+	pthread_mutex_lock(&mutex);
+	while (!done)
+	{
+		while (!items && !done)
+			pthread_cond_wait(&cond, &mutex);
+		if (items)
+			items--;
+	}
+	pthread_mutex_unlock(&mutex);
+
+	return NULL;
+}
+
+/*! Average duration of producer round (broadcast + consuming), in us */
+static int measure(int requeue)
+{
+	pthread_t thr[CONSUMERS];
+	pthread_attr_t attr;
+	sched_param_t param = { .sched_priority = THREAD_DEF_PRIO + 1 };
+	char info[INFO_SIZE];
+	char *sysinfo_args[] = {"sysinfo", "threads", NULL};
+	timespec_t t1, t2;
+	int i;
+
+	cond_requeue = requeue;
+	items = done = 0;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+	for (i = 0; i < CONSUMERS; i++)
+		pthread_create(&thr[i], &attr, consumer, NULL);
+
+	/* thread switches counter, before (printed on console) */
+	syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < ROUNDS; i++)
+	{
+		/* broadcast while holding mutex: released consumers block */
+		pthread_mutex_lock(&mutex);
+		items += CONSUMERS;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	/* and after */
+	syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+
+	pthread_mutex_lock(&mutex);
+	done = 1;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+
+	for (i = 0; i < CONSUMERS; i++)
+		pthread_join(thr[i], NULL);
+
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+	cond_requeue = TRUE;
+
+	return t2.tv_sec * (1000000 / ROUNDS) + t2.tv_nsec / 1000 / ROUNDS;
+}
+
+int cond_bench(char *args[])
+{
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	printf("%d consumers, %d broadcasts; compare thread switches "
+		"printed before and after each run\n", CONSUMERS, ROUNDS);
+
+	printf("wake all: %d us per round\n", measure(FALSE));
+	printf("requeue:  %d us per round\n", measure(TRUE));
+
+	return 0;
+}
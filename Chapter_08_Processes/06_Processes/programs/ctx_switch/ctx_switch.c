@@ -0,0 +1,112 @@
+/*! Context switch cost: between threads of a process and between processes */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <syscall.h>
+#include <lib/string.h>
+#include <errno.h>
+
+char PROG_HELP[] = "Measure thread switch time: message ping-pong between two "
+		   "threads of one process and between two processes.";
+
+#define ROUNDS		10000	/* ping-pong exchanges per measurement */
+#define MSG_SIZE	4
+#define INFO_SIZE	100
+
+static char ping_name[] = "ctx_ping", pong_name[] = "ctx_pong";
+
+/*! Echo messages from ping to pong queue (the other side of the exchange) */
+static void *ponger(void *param)
+{
+	mqd_t ping, pong;
+	char msg[MSG_SIZE];
+	uint prio;
+	int i;
+
+	ping = mq_open(ping_name, O_RDONLY, 0, NULL);
+	pong = mq_open(pong_name, O_WRONLY, 0, NULL);
+
+	for (i = 0; i < ROUNDS; i++)
+	{
+		mq_receive(ping, msg, MSG_SIZE, &prio);
+		mq_send(pong, msg, MSG_SIZE, 0);
+	}
+
+	mq_close(ping);
+	mq_close(pong);
+
+	return NULL;
+}
+
+/*! Send ping and wait for pong, 'ROUNDS' times; return ns per switch */
+static int pinger(mqd_t ping, mqd_t pong)
+{
+	char msg[MSG_SIZE] = "abc";
+	timespec_t t1, t2;
+	uint prio;
+	int i;
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < ROUNDS; i++)
+	{
+		mq_send(ping, msg, MSG_SIZE, 0);
+		mq_receive(pong, msg, MSG_SIZE, &prio);
+	}
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	/* two switches per round */
+	return t2.tv_sec * (1000000000 / ROUNDS / 2) + t2.tv_nsec / ROUNDS / 2;
+}
+
+int ctx_switch(char *args[])
+{
+	char *child_args[] = { "ctx_switch", "pong", NULL };
+	char info[INFO_SIZE];
+	char *sysinfo_args[] = {"sysinfo", "threads", NULL};
+	mqd_t ping, pong;
+	mq_attr_t attr;
+	pthread_t thr;
+
+	/* started by itself, for the other side of exchange */
+	if (args && args[0] && args[1] && !strcmp(args[1], "pong"))
+	{
+		ponger(NULL);
+		return 0;
+	}
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	attr.mq_flags = 0;
+	attr.mq_maxmsg = 1;
+	attr.mq_msgsize = MSG_SIZE;
+	attr.mq_curmsgs = 0;
+
+	ping = mq_open(ping_name, O_CREAT | O_WRONLY, 0, &attr);
+	pong = mq_open(pong_name, O_CREAT | O_RDONLY, 0, &attr);
+	if (ping.id == -1 || pong.id == -1)
+	{
+		printf("Error creating message queues!\n");
+		return EXIT_FAILURE;
+	}
+
+	pthread_create(&thr, NULL, ponger, NULL);
+	printf("threads of one process: %d ns per switch\n",
+		pinger(ping, pong));
+	pthread_join(thr, NULL);
+
+	posix_spawn(&thr, "ctx_switch", NULL, NULL, child_args, NULL);
+	printf("two processes: %d ns per switch\n", pinger(ping, pong));
+	pthread_join(thr, NULL);
+
+	mq_close(ping);
+	mq_close(pong);
+
+	/* switches statistics (printed on console) */
+	syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+	printf("Thread switches statistics%s\n", info);
+
+	return 0;
+}
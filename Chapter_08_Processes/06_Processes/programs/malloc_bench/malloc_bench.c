@@ -0,0 +1,155 @@
+/*! Multi-threaded allocation churn: malloc (thread caches) vs. GMA and first
+ *  fit protected with a mutex */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <malloc.h>
+#include <lib/gma.h>
+#include <lib/ff_simple.h>
+
+char PROG_HELP[] = "Threads allocate and free blocks of random sizes: "
+		   "malloc with thread caches vs. locked GMA and first fit.";
+
+#define THREADS		4
+#define OPS		20000	/* allocations (and frees) per thread */
+#define SLOTS		32	/* blocks held by thread at once */
+#define SMALL_MAX	256	/* most requests: 1 - SMALL_MAX bytes */
+#define LARGE_MAX	1024	/* every LARGE_EVERY-th: up to LARGE_MAX bytes */
+#define LARGE_EVERY	32
+#define POOL_SIZE	0x10000	/* for GMA and first fit */
+
+static char pool[POOL_SIZE];
+static void *mpool;
+static pthread_mutex_t lock;
+
+/* allocator under test */
+static void *(*alloc_f)(size_t size);
+static void (*free_f)(void *ptr);
+static int failed;
+
+static void *gma_locked_alloc(size_t size)
+{
+	void *ptr;
+
+	pthread_mutex_lock(&lock);
+	ptr = gma_alloc(mpool, size);
+	pthread_mutex_unlock(&lock);
+
+	return ptr;
+}
+static void gma_locked_free(void *ptr)
+{
+	pthread_mutex_lock(&lock);
+	gma_free(mpool, ptr);
+	pthread_mutex_unlock(&lock);
+}
+
+static void *ffs_locked_alloc(size_t size)
+{
+	void *ptr;
+
+	pthread_mutex_lock(&lock);
+	ptr = ffs_alloc(mpool, size);
+	pthread_mutex_unlock(&lock);
+
+	return ptr;
+}
+static void ffs_locked_free(void *ptr)
+{
+	pthread_mutex_lock(&lock);
+	ffs_free(mpool, ptr);
+	pthread_mutex_unlock(&lock);
+}
+
+static void *churn(void *param)
+{
+	void *slot[SLOTS] = { NULL };
+	uint seed = (uint) param;
+	size_t size;
+	int i, j;
+
+	for (i = 0; i < OPS; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		j = (seed >> 16) % SLOTS;
+
+		if (slot[j])
+			free_f(slot[j]);
+
+		if ((seed >> 8) % LARGE_EVERY)
+			size = 1 + (seed >> 20) % SMALL_MAX;
+		else
+			size = 1 + (seed >> 20) % LARGE_MAX;
+
+		slot[j] = alloc_f(size);
+		if (slot[j])
+			*((char *) slot[j]) = (char) i;
+		else
+			failed++;
+	}
+
+	for (j = 0; j < SLOTS; j++)
+		if (slot[j])
+			free_f(slot[j]);
+
+	return NULL;
+}
+
+/*! Average duration of allocation + free, in nanoseconds */
+static int measure()
+{
+	pthread_t thr[THREADS];
+	timespec_t t1, t2;
+	int i;
+
+	failed = 0;
+	pthread_mutex_init(&lock, NULL);
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < THREADS; i++)
+		pthread_create(&thr[i], NULL, churn, (void *) (i + 1));
+	for (i = 0; i < THREADS; i++)
+		pthread_join(thr[i], NULL);
+	clock_gettime(CLOCK_REALTIME, &t2);
+
+	pthread_mutex_destroy(&lock);
+
+	time_sub(&t2, &t1);
+
+	return t2.tv_sec * (1000000000 / (THREADS * OPS)) +
+		t2.tv_nsec / (THREADS * OPS);
+}
+
+int malloc_bench(char *args[])
+{
+	int t;
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	printf("%d threads, %d allocations each, %d blocks held per thread\n",
+		THREADS, OPS, SLOTS);
+
+	alloc_f = malloc;
+	free_f = free;
+	t = measure();
+	printf("malloc (thread caches): %d ns per alloc+free, %d failed\n",
+		t, failed);
+
+	mpool = gma_init(pool, POOL_SIZE, 32, NEW_MPOOL);
+	alloc_f = gma_locked_alloc;
+	free_f = gma_locked_free;
+	t = measure();
+	printf("GMA with mutex:         %d ns per alloc+free, %d failed\n",
+		t, failed);
+
+	mpool = ffs_init(pool, POOL_SIZE);
+	alloc_f = ffs_locked_alloc;
+	free_f = ffs_locked_free;
+	t = measure();
+	printf("first fit with mutex:   %d ns per alloc+free, %d failed\n",
+		t, failed);
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*! Priority inversion: mutex without and with priority inheritance/ceiling */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+char PROG_HELP[] = "Priority inversion with PTHREAD_PRIO_NONE, "
+		   "PTHREAD_PRIO_INHERIT and PTHREAD_PRIO_PROTECT mutexes.";
+
+#define PRIO_LOW	(THREAD_DEF_PRIO + 1)
+#define PRIO_MEDIUM	(THREAD_DEF_PRIO + 2)
+#define PRIO_HIGH	(THREAD_DEF_PRIO + 3)
+#define PRIO_MAIN	(THREAD_DEF_PRIO + 4)
+
+#define CRITICAL_MS	100	/* low priority thread holds mutex */
+#define MEDIUM_MS	1000	/* medium priority thread runs */
+
+static pthread_mutex_t mutex;
+static timespec_t high_wait;	/* how long high priority thread waited */
+
+/* busy loop for given time (thread may be preempted meanwhile) */
+static void busy(int ms)
+{
+	timespec_t end, now;
+
+	clock_gettime(CLOCK_REALTIME, &end);
+	end.tv_sec += ms / 1000;
+	end.tv_nsec += (ms % 1000) * 1000000;
+	if (end.tv_nsec >= 1000000000)
+	{
+		end.tv_sec++;
+		end.tv_nsec -= 1000000000;
+	}
+
+	do {
+		clock_gettime(CLOCK_REALTIME, &now);
+	}
+	while (time_cmp(&now, &end) < 0);
+}
+
+static void *low_thread(void *param)
+{
+	pthread_mutex_lock(&mutex);
+	busy(CRITICAL_MS);
+	pthread_mutex_unlock(&mutex);
+
+	return NULL;
+}
+
+static void *medium_thread(void *param)
+{
+	busy(MEDIUM_MS);
+
+	return NULL;
+}
+
+static void *high_thread(void *param)
+{
+	timespec_t t;
+
+	clock_gettime(CLOCK_REALTIME, &high_wait);
+	pthread_mutex_lock(&mutex);
+	clock_gettime(CLOCK_REALTIME, &t);
+	pthread_mutex_unlock(&mutex);
+
+	time_sub(&t, &high_wait);
+	high_wait = t;
+
+	return NULL;
+}
+
+static pthread_t start(void *(*func)(void *), int prio)
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+	sched_param_t sched_param = { .sched_priority = prio };
+
+	pthread_attr_init(&attr);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &sched_param);
+	pthread_create(&thread, &attr, func, NULL);
+
+	return thread;
+}
+
+static int inversion(int protocol)
+{
+	pthread_mutexattr_t attr;
+	pthread_t low, medium, high;
+	timespec_t delay = { .tv_sec = 0, .tv_nsec = 10000000 };
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, protocol);
+	pthread_mutexattr_setprioceiling(&attr, PRIO_HIGH);
+	pthread_mutex_init(&mutex, &attr);
+
+	/* let low priority thread lock mutex */
+	low = start(low_thread, PRIO_LOW);
+	nanosleep(&delay, NULL);
+
+	/* high blocks on mutex, medium then keeps processor from low */
+	high = start(high_thread, PRIO_HIGH);
+	medium = start(medium_thread, PRIO_MEDIUM);
+
+	pthread_join(high, NULL);
+	pthread_join(medium, NULL);
+	pthread_join(low, NULL);
+
+	pthread_mutex_destroy(&mutex);
+
+	return high_wait.tv_sec * 1000 + high_wait.tv_nsec / 1000000;
+}
+
+int prio_inherit(char *args[])
+{
+	sched_param_t param = { .sched_priority = PRIO_MAIN };
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	printf("Critical section %d ms, medium priority thread %d ms\n",
+		CRITICAL_MS, MEDIUM_MS);
+	printf("High priority thread waited (ms):\n");
+	printf("PTHREAD_PRIO_NONE:    %d (unbounded inversion)\n",
+		inversion(PTHREAD_PRIO_NONE));
+	printf("PTHREAD_PRIO_INHERIT: %d\n", inversion(PTHREAD_PRIO_INHERIT));
+	printf("PTHREAD_PRIO_PROTECT: %d\n", inversion(PTHREAD_PRIO_PROTECT));
+
+	return 0;
+}
@@ -67,6 +67,8 @@ int round_robin(char *args[])
 		 PROG_HELP);
 
 	sched_param.sched_priority = THREAD_DEF_PRIO/2 + 1;
+	sched_param.supp.rr.time_slice.tv_sec = 0;
+	sched_param.supp.rr.time_slice.tv_nsec = 20000000; /* 20 ms slice */
 	pthread_attr_init(&attr);
 	pthread_attr_setschedpolicy(&attr, SCHED_RR);
 	pthread_attr_setschedparam(&attr, &sched_param);
@@ -33,7 +33,7 @@ int run_all(char *args[])
 
 	char progs_to_start[] = {
 		"hello timer args uthreads threads semaphores "
-		"monitors messages signals rr" };
+		"monitors messages signals rr spawn_bench" };
 	progname = progs_to_start;
 
 #endif
@@ -0,0 +1,52 @@
+/*! Scheduler cost: kthreads_schedule with low priority thread */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+char PROG_HELP[] = "Measure scheduler duration (build with different "
+		   "PRIO_LEVELS to compare, e.g. 'make PRIO_LEVELS=1024').";
+
+#define ITERS	50000
+
+/*! Average syscall duration, with or without priority change, in ns */
+static int measure(int change_prio)
+{
+	pthread_t self = pthread_self();
+	sched_param_t param[2] = { {.sched_priority = 1},
+				   {.sched_priority = 2} };
+	timespec_t t1, t2;
+	int i;
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < ITERS; i++)
+	{
+		if (change_prio) /* thread is moved to ready and scheduled */
+			pthread_setschedparam(self, SCHED_FIFO, &param[i & 1]);
+		else
+			pthread_self();
+	}
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	return t2.tv_sec * (1000000000 / ITERS) + t2.tv_nsec / ITERS;
+}
+
+int sched_bench(char *args[])
+{
+	int t_sched, t_empty;
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	/* lowest priorities (above idle thread): highest priority search
+	 * have to pass through all priority levels above */
+	t_empty = measure(FALSE);
+	t_sched = measure(TRUE);
+
+	printf("PRIO_LEVELS=%d: syscall %d ns, with scheduling %d ns, "
+		"scheduling cost %d ns\n", PRIO_LEVELS, t_empty, t_sched,
+		t_sched - t_empty);
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+/*! Timer slack: periodic sleepers with different phases, with/without slack */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <syscall.h>
+
+char PROG_HELP[] = "Periodic threads with slightly different phases: timer "
+		   "interrupts without and with timer slack.";
+
+#define SLEEPERS	4
+#define PERIOD		10000000	/* ns */
+#define PHASE		300000		/* ns; between sleepers */
+#define ROUNDS		50		/* periods per measurement */
+#define SLACK		2000000		/* ns; more than SLEEPERS * PHASE */
+#define INFO_SIZE	100
+
+static timespec_t start;
+
+/*! Sleep until start + phase + k * period, ROUNDS times */
+static void *sleeper(void *param)
+{
+	timespec_t next = start, period = { 0, PERIOD };
+	timespec_t phase = { 0, (int) param * PHASE };
+	int i;
+
+	time_add(&next, &phase);
+	for (i = 0; i < ROUNDS; i++)
+	{
+		time_add(&next, &period);
+		clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &next, NULL);
+	}
+
+	return NULL;
+}
+
+/*! Run sleepers with given slack (inherited from this thread) */
+static void measure(long slack)
+{
+	pthread_t thr[SLEEPERS];
+	char info[INFO_SIZE];
+	char *sysinfo_args[] = {"sysinfo", "threads", NULL};
+	int i;
+
+	prctl(PR_SET_TIMERSLACK, slack);
+	printf("timer slack %d ns:\n", prctl(PR_GET_TIMERSLACK, 0));
+
+	/* timer statistics, before and after (printed on console) */
+	syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+
+	clock_gettime(CLOCK_REALTIME, &start);
+	for (i = 0; i < SLEEPERS; i++)
+		pthread_create(&thr[i], NULL, sleeper, (void *) i);
+	for (i = 0; i < SLEEPERS; i++)
+		pthread_join(thr[i], NULL);
+
+	syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+}
+
+int slack_bench(char *args[])
+{
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	measure(1);
+	measure(SLACK);
+
+	prctl(PR_SET_TIMERSLACK, 0); /* back to default */
+
+	return 0;
+}
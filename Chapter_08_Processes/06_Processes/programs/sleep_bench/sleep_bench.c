@@ -0,0 +1,59 @@
+/*! Periodic sleep: cost per period and kernel allocations made by sleeps */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <syscall.h>
+
+char PROG_HELP[] = "Periodic thread (clock_nanosleep to absolute time): "
+		   "kernel allocations must not grow with number of sleeps.";
+
+#define ROUNDS		100000
+#define PERIOD		100000	/* ns */
+#define INFO_SIZE	100
+
+/*! Kernel allocations since boot (heap, object caches, ids) */
+static int kernel_allocs()
+{
+	char info[INFO_SIZE];
+	char *sysinfo_args[] = {"sysinfo", "allocs", NULL};
+
+	return syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+}
+
+int sleep_bench(char *args[])
+{
+	timespec_t start, next, end, period = { 0, PERIOD };
+	int i, allocs, late;
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	prctl(PR_SET_TIMERSLACK, 1); /* measure sleep without slack */
+
+	allocs = kernel_allocs();
+
+	clock_gettime(CLOCK_REALTIME, &start);
+	next = start;
+	for (i = 0; i < ROUNDS; i++)
+	{
+		time_add(&next, &period);
+		clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &next, NULL);
+	}
+	clock_gettime(CLOCK_REALTIME, &end);
+
+	allocs = kernel_allocs() - allocs;
+
+	/* wake up delay after last period */
+	time_sub(&end, &next);
+	late = end.tv_sec * 1000000 + end.tv_nsec / 1000;
+
+	prctl(PR_SET_TIMERSLACK, 0);
+
+	printf("%d sleeps, period %d us: last wake up %d us late\n",
+		 ROUNDS, PERIOD / 1000, late);
+	printf("kernel allocations during sleeps: %d (%s)\n", allocs,
+		 allocs < ROUNDS / 100 ? "flat" : "grows with sleeps!");
+
+	return 0;
+}
@@ -0,0 +1,83 @@
+/*! Process creation: spawn latency and memory used per process */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <syscall.h>
+#include <lib/string.h>
+
+char PROG_HELP[] = "Spawn copies of this program: average spawn+join duration "
+		   "and pages used per running process.";
+
+#define SPAWNS		20	/* for latency */
+#define RUNNING		8	/* processes alive at once, for footprint */
+#define INFO_SIZE	100
+
+static char *child_args[] = { "spawn_bench", "child", NULL };
+static char *sleeper_args[] = { "spawn_bench", "sleep", NULL };
+
+/*! Pages used from page pool (-1 if kernel doesn't use paging) */
+static int pages_used()
+{
+	char info[INFO_SIZE];
+	char *sysinfo_args[] = { "sysinfo", "pages", NULL };
+
+	return syscall(SYSINFO, &info, INFO_SIZE, sysinfo_args);
+}
+
+int spawn_bench(char *args[])
+{
+	pthread_t thr[RUNNING];
+	timespec_t t1, t2;
+	timespec_t delay = { .tv_sec = 0, .tv_nsec = 100000000 };
+	int i, us, pages;
+
+	if (args && args[0] && args[1])
+	{
+		/* started from this program: exit at once or after a while */
+		if (!strcmp(args[1], "sleep"))
+			nanosleep(&delay, NULL);
+		return 0;
+	}
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < SPAWNS; i++)
+	{
+		if (posix_spawn(&thr[0], "spawn_bench", NULL, NULL,
+				 child_args, NULL))
+		{
+			printf("spawn failed!\n");
+			return -1;
+		}
+		pthread_join(thr[0], NULL);
+	}
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+	us = t2.tv_sec * (1000000 / SPAWNS) + t2.tv_nsec / (1000 * SPAWNS);
+
+	printf("spawn + join: %d us\n", us);
+
+	pages = pages_used();
+	for (i = 0; i < RUNNING; i++)
+		if (posix_spawn(&thr[i], "spawn_bench", NULL, NULL,
+				 sleeper_args, NULL))
+			break;
+
+	/* let them run until they sleep */
+	delay.tv_nsec /= 2;
+	nanosleep(&delay, NULL);
+
+	if (pages >= 0 && i > 0)
+		printf("%d processes running: %d pages each\n", i,
+			 (pages_used() - pages) / i);
+	else
+		printf("%d processes running: (pages not used)\n", i);
+
+	while (i > 0)
+		pthread_join(thr[--i], NULL);
+
+	return 0;
+}
@@ -8,9 +8,30 @@ char PROG_HELP[] = "Test SSE support by using SSE register.";
 
 #define THR_NUM	3
 #define ITERS	5
+#define LAT_ITERS	100000	/* syscalls for latency measurement */
 
 static timespec_t sleep;
 
+/*!
+ * Measure average syscall duration (pthread_self is almost empty syscall);
+ * with USE_SSE every interrupt saves and restores extended context, while
+ * with SSE_LAZY that is done only when another thread uses FPU/MMX/SSE
+ */
+static void syscall_latency(char *descr)
+{
+	timespec_t t1, t2;
+	int i;
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < LAT_ITERS; i++)
+		pthread_self();
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	printf("%s: %d ns per syscall\n", descr,
+		t2.tv_sec * (1000000000 / LAT_ITERS) + t2.tv_nsec / LAT_ITERS);
+}
+
 static void *sse_test_thread(void *param)
 {
 	int thr_no = (int) param;
@@ -73,5 +94,18 @@ int sse_test(char *args[])
 	for (j = 0; j < i; j++)
 		pthread_join(thread[j], NULL);
 
+#if defined(USE_SSE) && defined(SSE_LAZY)
+	printf("\nSyscall latency (lazy FPU/SSE context switching)\n");
+#elif defined(USE_SSE)
+	printf("\nSyscall latency (eager FPU/SSE context switching)\n");
+#else
+	printf("\nSyscall latency (FPU/SSE context not saved)\n");
+#endif
+	syscall_latency("thread without FPU use");
+#ifdef USE_SSE
+	asm volatile ("xorps %%xmm0, %%xmm0" ::: "memory");
+	syscall_latency("thread using SSE");
+#endif
+
 	return 0;
 }
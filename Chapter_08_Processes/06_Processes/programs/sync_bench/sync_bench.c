@@ -0,0 +1,85 @@
+/*! Uncontended synchronization cost: futex fast path vs. kernel objects */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+char PROG_HELP[] = "Measure uncontended lock/unlock and post/wait duration.";
+
+#define ITERS	100000	/* operation pairs per measurement */
+
+static timespec_t t1;
+
+static void start()
+{
+	clock_gettime(CLOCK_REALTIME, &t1);
+}
+
+/*! Average duration of operation pair since start(), in nanoseconds */
+static int stop()
+{
+	timespec_t t2;
+
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	return t2.tv_sec * (1000000000 / ITERS) + t2.tv_nsec / ITERS;
+}
+
+static int mutex_duration(int protocol)
+{
+	pthread_mutex_t mutex;
+	pthread_mutexattr_t attr;
+	int i, t;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, protocol);
+	pthread_mutex_init(&mutex, &attr);
+
+	start();
+	for (i = 0; i < ITERS; i++)
+	{
+		pthread_mutex_lock(&mutex);
+		pthread_mutex_unlock(&mutex);
+	}
+	t = stop();
+
+	pthread_mutex_destroy(&mutex);
+
+	return t;
+}
+
+static int sem_duration()
+{
+	sem_t sem;
+	int i, t;
+
+	sem_init(&sem, 0, 0);
+
+	start();
+	for (i = 0; i < ITERS; i++)
+	{
+		sem_post(&sem);
+		sem_wait(&sem);
+	}
+	t = stop();
+
+	sem_destroy(&sem);
+
+	return t;
+}
+
+int sync_bench(char *args[])
+{
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	printf("mutex (futex, user space): %d ns per lock+unlock\n",
+		mutex_duration(PTHREAD_PRIO_NONE));
+	printf("mutex (PI, kernel object): %d ns per lock+unlock\n",
+		mutex_duration(PTHREAD_PRIO_INHERIT));
+	printf("semaphore (futex, user space): %d ns per post+wait\n",
+		sem_duration());
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*! Syscall entry cost: software interrupt vs. sysenter */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <syscall.h>
+#include <kernel/features.h>
+
+char PROG_HELP[] = "Measure syscall duration with both entry methods "
+		   "and clock_gettime duration.";
+
+#define ITERS	100000	/* syscalls per measurement */
+
+/*! Average duration of (almost empty) syscall, in nanoseconds */
+static int syscall_duration(int fast)
+{
+	timespec_t t1, t2;
+	int i, prev = syscall_fast;
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+
+	syscall_fast = fast;
+	for (i = 0; i < ITERS; i++)
+		pthread_self();
+	for (i = 0; i < ITERS; i++)
+		sys_feature(FEATURE_SCHED_RR, FEATURE_GET, 0);
+	syscall_fast = prev;
+
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	return t2.tv_sec * (1000000000 / ITERS / 2) + t2.tv_nsec / ITERS / 2;
+}
+
+/*! Average duration of clock_gettime (kernel reads timer counter or TSC) */
+static int clock_gettime_duration()
+{
+	timespec_t t1, t2, t;
+	int i;
+
+	clock_gettime(CLOCK_REALTIME, &t1);
+	for (i = 0; i < ITERS; i++)
+		clock_gettime(CLOCK_REALTIME, &t);
+	clock_gettime(CLOCK_REALTIME, &t2);
+	time_sub(&t2, &t1);
+
+	return t2.tv_sec * (1000000000 / ITERS) + t2.tv_nsec / ITERS;
+}
+
+int syscall_bench(char *args[])
+{
+	int t_int, t_fast;
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	t_int = syscall_duration(FALSE);
+	printf("software interrupt: %d ns per syscall\n", t_int);
+	printf("clock_gettime: %d ns per call\n", clock_gettime_duration());
+
+	if (!syscall_fast)
+	{
+		printf("sysenter: not available\n");
+		return 0;
+	}
+
+	t_fast = syscall_duration(TRUE);
+	printf("sysenter: %d ns per syscall\n", t_fast);
+	printf("saved: %d ns per syscall\n", t_int - t_fast);
+
+	return 0;
+}
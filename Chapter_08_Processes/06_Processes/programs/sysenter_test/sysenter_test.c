@@ -0,0 +1,74 @@
+/*! Sysenter with invalid stack pointer: only calling thread is affected */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <syscall.h>
+
+char PROG_HELP[] = "Threads enter kernel with sysenter, with stack pointer "
+		   "(ebp) on untouched heap page and outside process: "
+		   "kernel must survive.";
+
+#define GROW		0x4000	/* heap extension; its pages are not touched */
+#define EXIT_STATUS	((void *) 0x5ec0)
+
+/*!
+ * Call pthread_exit through sysenter with given ebp (kernel reads return
+ * address from it, but thread exits without returning)
+ */
+static void *bad_sysenter(void *ebp)
+{
+	asm volatile (	"movl	%%ecx, %%ebp\n\t"
+			"sysenter\n\t"
+			:: "a" (PTHREAD_EXIT), "D" (EXIT_STATUS), "c" (ebp)
+			: "memory" );
+
+	return NULL; /* not reached */
+}
+
+/*! Run thread with 'ebp'; return its exit status */
+static void *run(void *ebp)
+{
+	pthread_t thr;
+	void *status = NULL;
+
+	pthread_create(&thr, NULL, bad_sysenter, ebp);
+	pthread_join(thr, &status);
+
+	return status;
+}
+
+int sysenter_test(char *args[])
+{
+	void *heap;
+
+	printf("Example program: [%s:%s]\n%s\n\n", __FILE__, __FUNCTION__,
+		 PROG_HELP);
+
+	if (!syscall_fast)
+	{
+		printf("sysenter: not available\n");
+		return 0;
+	}
+
+	/* return address on page that isn't mapped yet (with PAGING) */
+	heap = sbrk(GROW);
+	if (heap == (void *) -1)
+	{
+		printf("sbrk failed\n");
+		return -1;
+	}
+	printf("ebp on untouched page: thread %s\n",
+		 run(heap + GROW / 2) == EXIT_STATUS ?
+		 "exited normally" : "failed!");
+	sbrk(-GROW);
+
+	/* stack pointer outside process: thread is terminated (as on #GP) */
+	printf("ebp outside process: thread %s\n",
+		 run((void *) 0xfffffff0) == EXIT_STATUS ?
+		 "exited (check should have failed!)" : "terminated");
+
+	printf("kernel survived\n");
+
+	return 0;
+}
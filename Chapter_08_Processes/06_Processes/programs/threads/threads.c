@@ -12,6 +12,13 @@ char PROG_HELP[] = "Thread demonstration example: create several threads that "
 		   "perform simple iterations and print basic info.";
 
 static timespec_t sleep;
+static pthread_key_t key;
+
+/* called at thread exit with its thread specific value */
+static void key_destructor(void *value)
+{
+	printf("Thread with specific data %d: destructor\n", (int) value);
+}
 
 /* example threads */
 static void *simple_thread(void *param)
@@ -21,9 +28,11 @@ static void *simple_thread(void *param)
 	thr_no = (int) param;
 
 	printf("Thread %d starting\n", thr_no);
+	pthread_setspecific(key, (void *) (thr_no + 1));
 	for (i = 1; i <= ITERS; i++)
 	{
-		printf("Thread %d: iter %d\n", thr_no, i);
+		printf("Thread %d: iter %d (specific data: %d)\n", thr_no, i,
+			(int) pthread_getspecific(key));
 		nanosleep(&sleep, NULL);
 	}
 	printf("Thread %d exiting\n", thr_no);
@@ -43,6 +52,8 @@ int threads(char *args[])
 	sleep.tv_sec = 1;
 	sleep.tv_nsec = 0;
 
+	pthread_key_create(&key, key_destructor);
+
 	for (i = 0; i < THR_NUM; i++)
 		if (pthread_create(&thread[i], NULL, simple_thread, (void *)i))
 		{
@@ -53,6 +64,8 @@ int threads(char *args[])
 	for (j = 0; j < i; j++)
 		pthread_join(thread[j], NULL);
 
+	pthread_key_delete(key);
+
 	printf("\nerrno test\n");
 
 	errno_by_get = get_errno();
@@ -0,0 +1,217 @@
+/*! Pack program (.bin) into compressed module (host tool, used by Makefile)
+ *
+ * Usage: lzpack program.bin program.lz
+ *
+ * Packed module (see module_packed_t in include/arch/memory.h):
+ * - header: module header (magic, name) from program, type MS_PROGRAM_LZ,
+ *   end - start = packed module size; program size; sizes of unpacked part
+ *   and of LZ4 block
+ * - first RAW_SIZE bytes of program, unpacked (program header is read by
+ *   kernel without decompressing)
+ * - rest of program as LZ4 block (lib/lz4.c decompresses it)
+ * Packed module size is padded to multiple of 4 (kernel looks for modules on
+ * 4 byte aligned addresses).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* from include/arch/memory.h (must match!) */
+#define PMAGIC1		0x11235813
+#define PMAGIC2		0x16180334
+#define MS_PROGRAM	5
+#define MS_PROGRAM_LZ	9
+
+/* program header is smaller (module_program_t), rest is aligned to 4 */
+#define RAW_SIZE	128
+
+/*! module_packed_t, as kernel (i386) sees it */
+typedef struct
+{
+	uint32_t magic[4];
+	uint32_t type;
+	uint32_t start;
+	uint32_t end;
+	char     name[16];
+	uint32_t size;
+	uint32_t raw_size;
+	uint32_t lz_size;
+}
+packed_t;
+
+/* LZ4 block format limits */
+#define MIN_MATCH	4
+#define LAST_LITERALS	5	/* last bytes are always literals */
+#define MF_LIMIT	12	/* last match must start before end - MF_LIMIT */
+#define MAX_OFFSET	65535
+
+#define HASH_BITS	16
+#define HASH(p)		((read32(p) * 2654435761U) >> (32 - HASH_BITS))
+
+static inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, 4);
+	return v;
+}
+
+/*! Write length continuation bytes (length over 15) */
+static uint8_t *put_length(uint8_t *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+
+	return op;
+}
+
+/*! Write sequence: literals from 'lit' to 'ip', then match (if 'mlen') */
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *lit,
+			     const uint8_t *ip, size_t offset, size_t mlen)
+{
+	size_t llen = ip - lit;
+	uint8_t *token = op++;
+
+	*token = (llen < 15 ? llen : 15) << 4;
+	if (llen >= 15)
+		op = put_length(op, llen - 15);
+	memcpy(op, lit, llen);
+	op += llen;
+
+	if (mlen)
+	{
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		mlen -= MIN_MATCH;
+		*token |= mlen < 15 ? mlen : 15;
+		if (mlen >= 15)
+			op = put_length(op, mlen - 15);
+	}
+
+	return op;
+}
+
+/*!
+ * Greedy LZ4 compression (one hash table entry per 4-byte sequence)
+ * \return compressed size ('dst' must have space for worst case)
+ */
+static size_t compress(const uint8_t *src, size_t size, uint8_t *dst)
+{
+	static uint32_t table[1 << HASH_BITS];
+	const uint8_t *ip = src, *lit = src, *end = src + size, *match;
+	const uint8_t *mflimit = end - MF_LIMIT, *mlimit = end - LAST_LITERALS;
+	uint8_t *op = dst;
+	size_t mlen;
+	uint32_t h;
+
+	memset(table, 0xff, sizeof(table));
+
+	while (size > MF_LIMIT && ip < mflimit)
+	{
+		h = HASH(ip);
+		match = table[h] != 0xffffffff ? src + table[h] : NULL;
+		table[h] = ip - src;
+
+		if (!match || ip - match > MAX_OFFSET ||
+		    read32(match) != read32(ip))
+		{
+			ip++;
+			continue;
+		}
+
+		for (mlen = MIN_MATCH; ip + mlen < mlimit &&
+		     match[mlen] == ip[mlen]; mlen++)
+			;
+
+		op = put_sequence(op, lit, ip, ip - match, mlen);
+		ip += mlen;
+		lit = ip;
+	}
+
+	return put_sequence(op, lit, end, 0, 0) - dst;
+}
+
+static void *read_file(const char *name, size_t *size)
+{
+	FILE *f = fopen(name, "rb");
+	void *buf;
+	long len;
+
+	if (!f || fseek(f, 0, SEEK_END) || (len = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET))
+		return NULL;
+
+	buf = malloc(len + 1);
+	if (!buf || fread(buf, 1, len, f) != len)
+		return NULL;
+	fclose(f);
+
+	*size = len;
+
+	return buf;
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t *image, *out;
+	packed_t hdr, *prog;
+	size_t size, packed;
+	FILE *f;
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: %s program.bin program.lz\n", argv[0]);
+		return 1;
+	}
+
+	image = read_file(argv[1], &size);
+	if (!image)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+
+	prog = (packed_t *) image;
+	if (size < RAW_SIZE || prog->magic[0] != PMAGIC1 ||
+	    prog->magic[1] != ~PMAGIC1 || prog->magic[2] != PMAGIC2 ||
+	    prog->magic[3] != ~PMAGIC2 || prog->type != MS_PROGRAM)
+	{
+		fprintf(stderr, "%s: not a program module\n", argv[1]);
+		return 1;
+	}
+
+	/* worst case: all literals */
+	out = malloc(sizeof(hdr) + RAW_SIZE + size + size / 255 + 16 + 3);
+	if (!out)
+		return 1;
+
+	packed = sizeof(hdr) + RAW_SIZE;
+	memcpy(out + sizeof(hdr), image, RAW_SIZE);
+	hdr.lz_size = compress(image + RAW_SIZE, size - RAW_SIZE,
+			       out + packed);
+	packed += hdr.lz_size;
+	while (packed % 4)
+		out[packed++] = 0;
+
+	memcpy(&hdr, prog, offsetof(packed_t, size));
+	hdr.type = MS_PROGRAM_LZ;
+	hdr.end = hdr.start + packed;
+	hdr.size = size;
+	hdr.raw_size = RAW_SIZE;
+	memcpy(out, &hdr, sizeof(hdr));
+
+	f = fopen(argv[2], "wb");
+	if (!f || fwrite(out, 1, packed, f) != packed || fclose(f))
+	{
+		perror(argv[2]);
+		return 1;
+	}
+
+	printf("[packing] %s: %zu -> %zu bytes\n", argv[1], size, packed);
+
+	return 0;
+}